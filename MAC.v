@@ -5,20 +5,26 @@ module mac #(
     parameter OUT_FRAC = 0,
     parameter MULT_LAT = 3,
     parameter ADD_LAT = 1,
-    parameter K = 1,
+    parameter K = 1,             // RESULT_CAPTURE=0: steps the finished psum waits in the delay line
     parameter ROWS = 1,
     parameter COLS = 1,
     parameter COLS_IDX = 1,
     parameter ROWS_IDX = 1,
-    parameter FIFO_DEPTH = 2
+    parameter FIFO_DEPTH = 2,   // finished psums held while draining, power of 2
+    parameter DRAIN_COLS = COLS, // columns in this MAC's drain group, values passed west per tile
+    parameter SKID = 0,          // cycles between raising mac_full_flag and seeing stall (registered stall)
+    parameter PACK = 1,          // independent products per cycle: 1, 2 (dual-INT4) or 4 (quad-INT2) for 8-bit inputs
+    parameter RESULT_CAPTURE = 1, // 1: queue the psum the step it is finished, 0: delay line of 2^clog2(COLS) psums
+    parameter HOLD = 0           // RESULT_CAPTURE=1: later psums that can be captured before this one is released
 )(
     input                      clk,
     input                      rst,
     input                      rst_accumulator_in,
     input                      stream_out_rdy_in,
+    input                      capture_in,
     input       [IN_WIDTH-1:0] row_data_in,
     input       [IN_WIDTH-1:0] col_data_in,
-    input       [IN_WIDTH-1:0] bypass_data_in, 
+    input      [OUT_WIDTH-1:0] bypass_data_in, 
     input                      bypass_data_in_vld,
     input                      stall,
     input                      mac_read_stall,
@@ -27,116 +33,208 @@ module mac #(
     output reg  [IN_WIDTH-1:0] col_data_out,
     output reg                 rst_accumulator_out,
     output reg                 stream_out_rdy_out,
+    output reg                 capture_out,
     output reg [OUT_WIDTH-1:0] psum_out,
     output reg                 psum_out_vld
 
 );
 
-    // psum will be max possible size of K
-    localparam COLS_WIDTH = $clog2(COLS);
-    reg [OUT_WIDTH-1:0] psum [0:(1 << COLS_WIDTH)-1];
+    // Result timing: ctrl releases every column in the same step, since
+    // the bypass chains of all drain groups have to start together, but
+    // column c finishes its sum COLS-1-c steps earlier, skewed like its
+    // inputs.
+    //
+    // RESULT_CAPTURE=0 keeps the finished sum in a delay line and queues
+    // psum[K] at stream_out_rdy: 2^clog2(COLS) psums per MAC, almost all
+    // of them idle.
+    //
+    // RESULT_CAPTURE=1 queues psum[0] in the step it is finished, on
+    // capture_in, and stream_out_rdy_in only releases it for draining.
+    // Up to HOLD later sums can be captured before the release, so the
+    // queue gets HOLD extra slots instead of the delay line.
+    localparam COLS_WIDTH  = $clog2(COLS);
+    localparam PSUM_DEPTH  = RESULT_CAPTURE ? 1 : (1 << COLS_WIDTH);
+    localparam QUEUE_DEPTH = FIFO_DEPTH + (RESULT_CAPTURE ? HOLD : 0) + SKID;
+    reg [OUT_WIDTH-1:0] psum [0:PSUM_DEPTH-1];
     reg [OUT_WIDTH-1:0] mult_out;
 
     wire [OUT_WIDTH-1:0]    multiplier_out;
     wire                    multiplier_done;
 
-    wire [IN_WIDTH-1:0]     adder_in_A;
-    wire [IN_WIDTH-1:0]     adder_in_B;
+    wire [OUT_WIDTH-1:0]    adder_in_A;
+    wire [OUT_WIDTH-1:0]    adder_in_B;
     wire [OUT_WIDTH-1:0]    adder_out;
     wire                    adder_done;
 
     wire                    fifo_full;
+    wire                    fifo_almost_full;
     wire                    fifo_empty;
     wire [OUT_WIDTH-1:0]    fifo_out;
 
+    // Queue write request, the write itself, and whether the head psum
+    // may start draining
+    wire                    queue_request;
+    wire                    queue_write;
+    wire [OUT_WIDTH-1:0]    queue_in;
+    wire                    drain_ready;
+    wire                    drain_start;
+
     // Bypass controls
     wire bypass_en;
-    wire [31:0] temp = COLS - 1;
+    wire [31:0] temp = DRAIN_COLS - 1;
     wire [$clog2(COLS)-1:0] bypass_counter_max = temp[$clog2(COLS)-1:0];
     reg  [$clog2(COLS)-1:0] bypass_counter;
     
+    // Packed lanes: input lane p is bits [p*LANE_IN +: LANE_IN] of row/col
+    // data, its product and running sum are bits [p*LANE_OUT +: LANE_OUT]
+    // of mult_out, psum and psum_out. Each lane has its own multiplier and
+    // adder, so sums never carry into the next lane; everything after the
+    // adder moves the OUT_WIDTH word as a whole.
+    localparam LANE_IN  = IN_WIDTH / PACK;
+    localparam LANE_OUT = OUT_WIDTH / PACK;
+
+    // Lanes run in lockstep, so the done flags agree; AND them so every
+    // lane's flag is read
+    wire [PACK-1:0] lane_multiplier_done;
+    wire [PACK-1:0] lane_adder_done;
+    assign multiplier_done = &lane_multiplier_done;
+    assign adder_done      = &lane_adder_done;
+
     // Fix-point multiplier
     wire [IN_WIDTH-1:0] mul_in_A = row_data_in;
     wire [IN_WIDTH-1:0] mul_in_B = col_data_in;
-    multiplier #(
-        .INPUT_A_WIDTH(IN_WIDTH),
-        .INPUT_B_WIDTH(IN_WIDTH),
-        .INPUT_A_FRAC(IN_FRAC),
-        .INPUT_B_FRAC(IN_FRAC),
-        .OUTPUT_WIDTH(OUT_WIDTH),
-        .OUTPUT_FRAC(OUT_FRAC),
-        .DELAY(MULT_LAT)
-    ) mul (
-        .clk(clk),
-        .reset(rst),
-        .stall(stall),
-        .en(~rst),
-        .a_in(mul_in_A),
-        .b_in(mul_in_B),
-        .out(multiplier_out),
-        .done(multiplier_done)
-    );
 
     // Fix-point adder
     assign adder_in_A = mult_out;
     assign adder_in_B = (rst_accumulator_in ? '0 : adder_out);
 
-    adder #(
-        .INPUT_A_WIDTH(IN_WIDTH),
-        .INPUT_B_WIDTH(IN_WIDTH),
-        .INPUT_A_FRAC(IN_FRAC),
-        .INPUT_B_FRAC(IN_FRAC),
-        .OUTPUT_WIDTH(OUT_WIDTH),
-        .OUTPUT_FRAC(OUT_FRAC),
-        .DELAY(ADD_LAT)
-    ) add(
-        .clk(clk),
-        .reset(rst),
-        .stall(stall),
-        .en(~rst && multiplier_done),
-        .a_in(adder_in_A),
-        .b_in(adder_in_B),
-        .out(adder_out),
-        .done(adder_done)
-    );
+    generate
+        genvar p;
+        for (p = 0; p < PACK; p = p + 1) begin: lane
+            multiplier #(
+                .INPUT_A_WIDTH(LANE_IN),
+                .INPUT_B_WIDTH(LANE_IN),
+                .INPUT_A_FRAC(IN_FRAC),
+                .INPUT_B_FRAC(IN_FRAC),
+                .OUTPUT_WIDTH(LANE_OUT),
+                .OUTPUT_FRAC(OUT_FRAC),
+                .DELAY(MULT_LAT)
+            ) mul (
+                .clk(clk),
+                .reset(rst),
+                .stall(stall),
+                .en(~rst),
+                .a_in(mul_in_A[p*LANE_IN +: LANE_IN]),
+                .b_in(mul_in_B[p*LANE_IN +: LANE_IN]),
+                .out(multiplier_out[p*LANE_OUT +: LANE_OUT]),
+                .done(lane_multiplier_done[p])
+            );
+
+            // Both operands are already in the output format: the product and the running sum
+            adder #(
+                .INPUT_A_WIDTH(LANE_OUT),
+                .INPUT_B_WIDTH(LANE_OUT),
+                .INPUT_A_FRAC(OUT_FRAC),
+                .INPUT_B_FRAC(OUT_FRAC),
+                .OUTPUT_WIDTH(LANE_OUT),
+                .OUTPUT_FRAC(OUT_FRAC),
+                .DELAY(ADD_LAT)
+            ) add(
+                .clk(clk),
+                .reset(rst),
+                .stall(stall),
+                .en(~rst && multiplier_done),
+                .a_in(adder_in_A[p*LANE_OUT +: LANE_OUT]),
+                .b_in(adder_in_B[p*LANE_OUT +: LANE_OUT]),
+                .out(adder_out[p*LANE_OUT +: LANE_OUT]),
+                .done(lane_adder_done[p])
+            );
+        end
+    endgenerate
 
     // Output queue
+    // The accumulator starts on the next tile as soon as a finished psum is
+    // pushed here, so with FIFO_DEPTH=2 one result drains through the bypass
+    // chain while the next accumulates (ping-pong). Deeper queues absorb
+    // longer output backpressure before mac_full_flag stalls the array; the
+    // drain itself stays at one value per cycle per row, so for K < COLS the
+    // array cannot average more than K/COLS MACs per PE per cycle.
+    // With a registered stall SKID more psums can arrive after mac_full_flag
+    // is raised, so the queue gets SKID spare slots and flags ahead of time
     synchronous_fifo #(
-        .DEPTH(FIFO_DEPTH),
-        .DATA_WIDTH(IN_WIDTH)
+        .DEPTH(QUEUE_DEPTH),
+        .DATA_WIDTH(OUT_WIDTH),
+        .ALMOST_FULL_FREE(SKID)
     ) output_fifo(
         .clk(clk),
         .rst_n(rst),
-        .w_en(stream_out_rdy_in && !stall),
-        .r_en(!bypass_en && !fifo_empty && !mac_read_stall),
-        .data_in(psum[K]),
+        .w_en(queue_write),
+        .r_en(drain_start),
+        .data_in(queue_in),
         .data_out(fifo_out),
         .full(fifo_full),
         .half_full(),
-        .empty(fifo_empty)
+        .empty(fifo_empty),
+        .almost_full(fifo_almost_full),
+        .almost_empty()
     );
 
-    assign mac_full_flag = stream_out_rdy_in & fifo_full;
+    // The flag drives stall, so it is taken from the write request, never
+    // from queue_write, which stall gates. A delayed stall cannot be tied
+    // to the request: flag whenever fewer than SKID+1 slots are free
+    assign mac_full_flag = (SKID == 0) ? (queue_request & fifo_full) : fifo_almost_full;
+
+    assign drain_start = !bypass_en && drain_ready && !mac_read_stall;
+
+    generate
+        if (RESULT_CAPTURE) begin: capture
+            // Released psums still in the queue, always the oldest ones
+            reg [$clog2(QUEUE_DEPTH+1)-1:0] released;
+
+            always @(posedge clk) begin
+                if (rst) begin
+                    released <= 0;
+                end else if (stream_out_rdy_in && !stall && !drain_start) begin
+                    released <= released + 1;
+                end else if (drain_start && !(stream_out_rdy_in && !stall)) begin
+                    released <= released - 1;
+                end
+            end
+
+            assign queue_request = capture_in;
+            assign queue_write   = queue_request && !stall;
+            assign queue_in      = psum[0];
+            assign drain_ready   = (released != 0);
+        end else begin: delay_line
+            assign queue_request = stream_out_rdy_in;
+            assign queue_write   = queue_request && !stall;
+            assign queue_in      = psum[K];
+            assign drain_ready   = !fifo_empty;
+        end
+    endgenerate
 
-    //pass the row/col/rst/stream_out data 1 clock cycle later
+    //pass the row/col/rst/stream_out/capture data 1 clock cycle later
     always @(posedge clk) begin
         if (rst) begin
             row_data_out        <= 0;
             col_data_out        <= 0;
             rst_accumulator_out <= 0;
             stream_out_rdy_out  <= 0;
+            capture_out         <= 0;
         end
         else if (stall) begin
             row_data_out        <= row_data_out;
             col_data_out        <= col_data_out;
             rst_accumulator_out <= rst_accumulator_out;
             stream_out_rdy_out  <= stream_out_rdy_out;
+            capture_out         <= capture_out;
         end
         else begin
             row_data_out        <= row_data_in;
             col_data_out        <= col_data_in;
             rst_accumulator_out <= rst_accumulator_in;
             stream_out_rdy_out  <= stream_out_rdy_in;
+            capture_out         <= capture_in;
         end
     end
 
@@ -172,10 +270,10 @@ module mac #(
 
     // propagate the psum
     // The delay is to wait for all macs inside the array to be ready and is
-    // determined by K.
+    // determined by K. Empty with RESULT_CAPTURE.
     generate
         genvar i;
-        for (i = 0; i < (1 << COLS_WIDTH) - 1; i = i + 1) begin: psum_propagate
+        for (i = 0; i < PSUM_DEPTH - 1; i = i + 1) begin: psum_propagate
             always @(posedge clk) begin
                 if (rst) begin
                     psum[i+1] <= 0;
@@ -199,7 +297,7 @@ module mac #(
             bypass_counter <= bypass_counter;
         end else if (bypass_counter == bypass_counter_max) begin
             bypass_counter <= '0;
-        end else if (~fifo_empty || bypass_en) begin
+        end else if (drain_ready || bypass_en) begin
             bypass_counter <= bypass_counter + 1;
         end else begin
             bypass_counter <= '0;
@@ -217,7 +315,7 @@ module mac #(
             psum_out     <= psum_out;
             psum_out_vld <= psum_out_vld;
         end
-        else if (!fifo_empty && !bypass_en) begin
+        else if (drain_ready && !bypass_en) begin
             psum_out     <= fifo_out;
             psum_out_vld <= 1;
         end
@@ -0,0 +1,93 @@
+module mac_ws #(
+    parameter IN_WIDTH = 8,
+    parameter IN_FRAC = 0,
+    parameter OUT_WIDTH = 8,
+    parameter OUT_FRAC = 0,
+    parameter MULT_LAT = 3,
+    parameter ADD_LAT = 1
+)(
+    input                      clk,
+    input                      rst,
+    input       [IN_WIDTH-1:0] weight_in,      // shadow weight of the PE below (weights shift up)
+    input                      weight_shift,   // take weight_in into the shadow register
+    input       [IN_WIDTH-1:0] row_data_in,
+    input                      weight_swap_in, // row_data_in is the first element on the shadow weight
+    input      [OUT_WIDTH-1:0] psum_in,        // partial sum from the PE above
+    output reg  [IN_WIDTH-1:0] weight_out,
+    output reg  [IN_WIDTH-1:0] row_data_out,
+    output reg                 weight_swap_out,
+    output     [OUT_WIDTH-1:0] psum_out
+);
+
+    // Weight-stationary PE: the weight stays put while A streams east
+    // through the row and partial sums flow south through the column.
+    //
+    // weight_out is the shadow weight, loaded while the active one is in
+    // use. The swap travels with the A stream, so each PE moves to the new
+    // weight exactly when the first A element meant for it arrives, and
+    // elements still in flight from the previous tile keep the old one.
+    //
+    // An element entering at cycle t leaves its sum on psum_out at
+    // t+MULT_LAT+1; the PE below sees the same A row one cycle after this
+    // one, so its adder lines up with psum_in without extra delay.
+    reg  [IN_WIDTH-1:0] weight;
+
+    wire [IN_WIDTH-1:0] mul_in_B = weight_swap_in ? weight_out : weight;
+    wire [OUT_WIDTH-1:0] multiplier_out;
+
+    // Fix-point multiplier
+    multiplier #(
+        .INPUT_A_WIDTH(IN_WIDTH),
+        .INPUT_B_WIDTH(IN_WIDTH),
+        .INPUT_A_FRAC(IN_FRAC),
+        .INPUT_B_FRAC(IN_FRAC),
+        .OUTPUT_WIDTH(OUT_WIDTH),
+        .OUTPUT_FRAC(OUT_FRAC),
+        .DELAY(MULT_LAT)
+    ) mul (
+        .clk(clk),
+        .reset(rst),
+        .stall(1'b0),
+        .en(~rst),
+        .a_in(row_data_in),
+        .b_in(mul_in_B),
+        .out(multiplier_out),
+        .done()
+    );
+
+    // Fix-point adder, the product and the partial sum from above
+    adder #(
+        .INPUT_A_WIDTH(OUT_WIDTH),
+        .INPUT_B_WIDTH(OUT_WIDTH),
+        .INPUT_A_FRAC(OUT_FRAC),
+        .INPUT_B_FRAC(OUT_FRAC),
+        .OUTPUT_WIDTH(OUT_WIDTH),
+        .OUTPUT_FRAC(OUT_FRAC),
+        .DELAY(ADD_LAT)
+    ) add(
+        .clk(clk),
+        .reset(rst),
+        .stall(1'b0),
+        .en(~rst),
+        .a_in(multiplier_out),
+        .b_in(psum_in),
+        .out(psum_out),
+        .done()
+    );
+
+    always @(posedge clk) begin
+        if (rst) begin
+            weight          <= 0;
+            weight_out      <= 0;
+            row_data_out    <= 0;
+            weight_swap_out <= 0;
+        end else begin
+            if (weight_swap_in) weight <= weight_out;
+            if (weight_shift)   weight_out <= weight_in;
+            //pass the row data 1 clock cycle later
+            row_data_out    <= row_data_in;
+            weight_swap_out <= weight_swap_in;
+        end
+    end
+
+endmodule
@@ -0,0 +1,34 @@
+#!/bin/bash
+# Thread scaling benchmark for the verilated systolic_array model.
+# usage: bench_threads.sh "<ROWSxCOLSxK ...>" "<threads ...>" [num_tests]
+#
+# Every shape/thread-count pair is a perf build (-O3, no assertions, no
+# tracing) in its own object directory, so the numbers reflect the
+# scheduling of the model. num_tests defaults to 100 so reset and the final
+# drain do not dominate the run.
+
+SHAPES=${1:-"128x2x8 128x8x2 128x20x20 10x128x2 10x2x128"}
+THREADS=${2:-"1 2 4 8 16"}
+NUM_TESTS=${3:-100}
+
+mkdir -p obj_dir_bench
+REPORT=obj_dir_bench/bench_threads.log
+printf "%-12s %8s %12s %12s %14s\n" "shape" "threads" "cycles" "wall(s)" "cycles/sec" | tee $REPORT
+
+for shape in $SHAPES; do
+    IFS=x read ROWS COLS K <<< "$shape"
+    for t in $THREADS; do
+        dir=obj_dir_bench/${shape}_t${t}
+        log=$dir.log
+        make systolic_array_perf ROWS=$ROWS COLS=$COLS K=$K NUM_TESTS=$NUM_TESTS \
+            THREADS=$t OBJ_DIR_PERF=$dir > $log 2>&1
+        if [ $? -ne 0 ]; then
+            printf "%-12s %8s %12s %12s %14s\n" $shape $t "FAILED" "-" "-" | tee -a $REPORT
+            continue
+        fi
+        cycles=$(grep -m1 "^Cycles=" $log | cut -d= -f2)
+        wall=$(grep -m1 "^WallTime=" $log | cut -d= -f2 | tr -d s)
+        rate=$(grep -m1 "^CyclesPerSec=" $log | cut -d= -f2)
+        printf "%-12s %8s %12s %12s %14s\n" $shape $t $cycles $wall $rate | tee -a $REPORT
+    done
+done
@@ -8,11 +8,12 @@ module ctrl #(
 )(
     input clk,
     input rst,
-    input stall,
+    input [COLS-1:0] stall,  // one copy per column, all equal
     input input_rst_accumulator,
     input input_stream_out_rdy,
     output [COLS-1:0] rst_accumulator,
-    output [COLS-1:0] stream_out_rdy
+    output [COLS-1:0] stream_out_rdy,
+    output [COLS-1:0] capture
 );
 
     localparam MULTIPLIER_DELAY_SLOTS = (MULT_LAT < 1 ? 2 : MULT_LAT + 1);
@@ -34,7 +35,7 @@ module ctrl #(
         if (rst) begin
             rst_accumulator_reg_0 <= 0;
         end
-        else if (stall )begin
+        else if (stall[0]) begin
             rst_accumulator_reg_0[0] <= rst_accumulator_reg_0[0];
         end
         else begin
@@ -51,7 +52,7 @@ module ctrl #(
                 if (rst) begin
                     rst_accumulator_reg_0[j] <= 0;
                 end
-                else if (stall) begin
+                else if (stall[0]) begin
                     rst_accumulator_reg_0[j] <= rst_accumulator_reg_0[j];
                 end
                 else begin
@@ -72,7 +73,7 @@ module ctrl #(
         if (rst) begin
             rst_accumulator_reg_1_to_rest[0] <= 0;
         end
-        else if (stall) begin
+        else if (stall[1 % COLS]) begin
             rst_accumulator_reg_1_to_rest[0] <= rst_accumulator_reg_1_to_rest[0];
         end
         else begin
@@ -89,7 +90,7 @@ module ctrl #(
                 if (rst) begin
                     rst_accumulator_reg_1_to_rest[l] <= 0;
                 end
-                else if (stall) begin
+                else if (stall[l+1]) begin
                     rst_accumulator_reg_1_to_rest[l] <= rst_accumulator_reg_1_to_rest[l];
                 end
                 else begin
@@ -102,13 +103,14 @@ module ctrl #(
     // Output all the reset signals
     assign rst_accumulator[COLS-1:1] = rst_accumulator_reg_1_to_rest;
 
-    // Stream out signaled by reset of accumulator
+    // Stream out signaled by reset of accumulator. The delay line is
+    // longer than COLS, so its stages take turns on the stall copies.
     reg [MULT_LAT+ACC_LAT+COLS-1:0] stream_out_rdy_delay;
     always @(posedge clk) begin
         if (rst) begin
             stream_out_rdy_delay[0] <= 0;
         end
-        else if (stall) begin
+        else if (stall[0]) begin
             stream_out_rdy_delay[0] <= stream_out_rdy_delay[0];
         end
         else begin
@@ -121,7 +123,7 @@ module ctrl #(
                 if (rst) begin
                     stream_out_rdy_delay[l] <= 0;
                 end
-                else if (stall) begin
+                else if (stall[l % COLS]) begin
                     stream_out_rdy_delay[l] <= stream_out_rdy_delay[l];
                 end
                 else begin
@@ -131,17 +133,33 @@ module ctrl #(
         end
     endgenerate
 
-    // Output stream_out_rdy signals
+    // Output stream_out_rdy and capture signals
+    // Column c finishes its sum at tap MULT_LAT+ACC_LAT+c, skewed like the
+    // accumulator reset. Every column is released at the last column's tap,
+    // so all drain groups start their bypass chains in the same step and
+    // the output lanes fill in lockstep; a row_data_out beat needs every
+    // lane. capture pulses at every column's own tap; mac's RESULT_CAPTURE
+    // decides whether the sum waits in its result queue or its delay line.
     reg [COLS-1:0] stream_out_rdy_reg;
-    always @(posedge clk) begin
-        if (rst) begin
-            stream_out_rdy_reg <= 0;
-        end else if (stall) begin
-            stream_out_rdy_reg <= stream_out_rdy_reg;
-        end else begin
-            stream_out_rdy_reg <= {COLS{stream_out_rdy_delay[MULT_LAT+ACC_LAT+COLS-1]}};
+    reg [COLS-1:0] capture_reg;
+    generate
+        genvar c;
+        for (c = 0; c < COLS; c = c + 1) begin: taps
+            always @(posedge clk) begin
+                if (rst) begin
+                    stream_out_rdy_reg[c] <= 0;
+                    capture_reg[c]        <= 0;
+                end else if (stall[c]) begin
+                    stream_out_rdy_reg[c] <= stream_out_rdy_reg[c];
+                    capture_reg[c]        <= capture_reg[c];
+                end else begin
+                    stream_out_rdy_reg[c] <= stream_out_rdy_delay[MULT_LAT+ACC_LAT+COLS-1];
+                    capture_reg[c]        <= stream_out_rdy_delay[MULT_LAT+ACC_LAT+c];
+                end
+            end
         end
-    end
+    endgenerate
     assign stream_out_rdy = stream_out_rdy_reg;
+    assign capture        = capture_reg;
 
 endmodule
\ No newline at end of file
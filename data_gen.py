@@ -6,10 +6,13 @@ import numpy
 
 
 
-def generate_random_data_for_4_4_systolic_array(a_size=(4,4),b_size=(4,4), c_size=(4,4), data_bitwdith=3, num_test=4):
+def generate_random_data_for_4_4_systolic_array(a_size=(4,4),b_size=(4,4), c_size=(4,4), data_bitwdith=3, num_test=4, pack=1, skew=True):
     """
     This function generates random data for a 4x4 systolic array doing 4x4 matrix multiplication
     C = A * B
+    With pack > 1 every 8-bit element holds pack independent 8/pack-bit lanes (PACK=2, PACK=4)
+    and C is computed lane by lane, each lane sum wrapping at 8/pack bits
+    With skew=False A and B are written dense and unpadded, for an array built with INPUT_SKEW=1
     """
 
     if a_size[0] != c_size[0] or b_size[1] != c_size[1] or a_size[1] != b_size[0]:
@@ -19,11 +22,19 @@ def generate_random_data_for_4_4_systolic_array(a_size=(4,4),b_size=(4,4), c_siz
     b_matrix_list = []
     c_matrix_list = []
     for _ in range(num_test):
-        #generate a random a matrix
-        a_matrix = numpy.random.randint(0, 2 ** data_bitwdith, size=a_size)
-        b_matrix = numpy.random.randint(0, 2 ** data_bitwdith, size=b_size)
-        #c = numpy.matmul(a_matrix, b_matrix)
-        c_matrix = numpy.matmul(a_matrix, b_matrix)
+        #generate a random a matrix, one lane at a time
+        lane_width = 8 // pack
+        lane_bits = min(data_bitwdith, lane_width)
+        a_matrix = numpy.zeros(a_size, dtype=numpy.int64)
+        b_matrix = numpy.zeros(b_size, dtype=numpy.int64)
+        c_matrix = numpy.zeros(c_size, dtype=numpy.int64)
+        for lane in range(pack):
+            a_lane = numpy.random.randint(0, 2 ** lane_bits, size=a_size)
+            b_lane = numpy.random.randint(0, 2 ** lane_bits, size=b_size)
+            c_lane = numpy.matmul(a_lane, b_lane) % (2 ** lane_width)
+            a_matrix |= a_lane << (lane * lane_width)
+            b_matrix |= b_lane << (lane * lane_width)
+            c_matrix |= c_lane << (lane * lane_width)
         a_matrix_list.append(a_matrix)
         b_matrix_list.append(b_matrix)
         c_matrix_list.append(c_matrix)
@@ -45,6 +56,10 @@ def generate_random_data_for_4_4_systolic_array(a_size=(4,4),b_size=(4,4), c_siz
     for row_idx in range(c_size[0]):
         c_matrix_shifted[row_idx][row_idx:row_idx+c_size[1]*num_test] = c_matrix_merged[row_idx]
     
+    if not skew:
+        a_matrix_shifted = a_matrix_merged
+        b_matrix_shifted = b_matrix_merged
+
     a_matrix_shifted = a_matrix_shifted.astype(numpy.uint8)
     b_matrix_shifted = b_matrix_shifted.astype(numpy.uint8)
     c_matrix_shifted = c_matrix_shifted.astype(numpy.uint8)
@@ -182,6 +197,8 @@ if __name__ == "__main__":
     parser.add_argument("--c-size", type=str, default="4x4", help="Matrix C dimensions")
     parser.add_argument("--num-tests", type=int, default=1, help="Number of tests to generate")
     parser.add_argument('--seed', default=1, type=int, help="Random seed")
+    parser.add_argument("--dense", action="store_true", help="Leave A and B unskewed, for INPUT_SKEW=1")
+    parser.add_argument("--pack", type=int, default=1, choices=[1, 2, 4], help="Packed lanes per 8-bit element")
     args = parser.parse_args()
 
     numpy.random.seed(args.seed)
@@ -197,7 +214,7 @@ if __name__ == "__main__":
     
     if args.mode == "gen_data":
         # generate_random_data_for_4_4_systolic_array(num_test=num_test)
-        generate_random_data_for_4_4_systolic_array(a_size=a_size, b_size=b_size, c_size=c_size, num_test=args.num_tests)
+        generate_random_data_for_4_4_systolic_array(a_size=a_size, b_size=b_size, c_size=c_size, num_test=args.num_tests, pack=args.pack, skew=not args.dense)
     else:
         # result = verify_results("c_matrix.bin", "results.bin")
         result = verify_results("d_matrix.bin", "results.bin", row_size=a_size[0], col_size=c_size[1], k_size=a_size[1], num_tests=args.num_tests)
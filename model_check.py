@@ -0,0 +1,175 @@
+import argparse
+import csv
+import itertools
+import os
+import re
+import subprocess
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+import sweep
+
+
+
+# Make variables of the RTL build that the model takes as plusargs; the
+# others (widths, PACK, THREADS, ...) do not change the timing
+MODEL_PARAMS = ["MAC_FIFO_DEPTH", "IN_FIFO_DEPTH", "OUT_FIFO_DEPTH", "CREDIT_FLOW", "DRAIN_LANES",
+                "REGISTERED_STALL", "INPUT_SKEW", "RESULT_CAPTURE"]
+
+CATEGORIES = ["active", "out_stall", "mac_stall", "starve_a", "starve_b"]
+
+CSV_FIELDS = ["rows", "cols", "k", "num_tests", "seed", "settings", "run_args", "rtl_status", "model_status",
+              "rtl_cycles", "model_cycles", "cycles_error", "rtl_stall_fraction", "model_stall_fraction",
+              "breakdown_error", "rtl_latency_p50", "model_latency_p50", "rtl_wall_time", "model_wall_time",
+              "speedup"]
+
+
+def summary(text):
+    """
+    Cycles, stall cycles, utilization breakdown (fractions) and latency of one bench or model run
+    """
+    values = dict(re.findall(r"^(\w+)=(\S+)$", text, re.MULTILINE))
+    result = {"status": "PASSED" if re.search(r"^PASSED!", text, re.MULTILINE) else "FAILED",
+              "cycles": int(values["Cycles"]) if "Cycles" in values else None,
+              "stall_cycles": int(values.get("StallCycles", 0)),
+              "wall_time": float(values.get("WallTime", "0").rstrip("s")),
+              "latency_p50": None, "breakdown": {}}
+    total = re.search(r"^Utilization over (\d+) cycles", text, re.MULTILINE)
+    if total and int(total.group(1)) > 0:
+        for name, n in re.findall(r"^\s+(\w+)\s+(\d+)\s+[\d.]+%$", text, re.MULTILINE):
+            if name in CATEGORIES:
+                result["breakdown"][name] = int(n) / int(total.group(1))
+    latency = re.search(r"^Latency over .* p50=(\d+)", text, re.MULTILINE)
+    if latency:
+        result["latency_p50"] = int(latency.group(1))
+    return result
+
+
+def run_model(job, run_args, args):
+    """
+    Runs one (config, num_tests, seed) point on the C++ model
+    """
+    (rows, cols, k), num_tests, seed = job
+    cmd = [args.model, f"+rows={rows}", f"+cols={cols}", f"+k={k}", f"+num_tests={num_tests}", f"+seed={seed}"]
+    for setting in args.set:
+        name, value = setting.split("=", 1)
+        if name in MODEL_PARAMS:
+            cmd.append(f"+{name.lower()}={value}")
+    if args.run_cycles:
+        cmd.append(f"+run_cycles={args.run_cycles}")
+    cmd += run_args.split()
+    out = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True).stdout
+    return summary(out)
+
+
+def run_rtl(job, run_args, binary, args):
+    """
+    Runs one point on the verilated bench through sweep.py and reads back its log
+    """
+    sweep_args = argparse.Namespace(**vars(args))
+    sweep_args.run_args = run_args
+    row = sweep.run(job, binary, sweep_args)
+    if not row["log"] or not os.path.exists(row["log"]) or binary is None:
+        return {"status": row["status"], "cycles": None, "stall_cycles": 0, "wall_time": 0.0,
+                "latency_p50": None, "breakdown": {}}
+    with open(row["log"]) as f:
+        return summary(f.read())
+
+
+def compare(job, run_args, rtl, model, args):
+    (rows, cols, k), num_tests, seed = job
+    row = {"rows": rows, "cols": cols, "k": k, "num_tests": num_tests, "seed": seed,
+           "settings": " ".join(args.set), "run_args": run_args,
+           "rtl_status": rtl["status"], "model_status": model["status"],
+           "rtl_cycles": rtl["cycles"], "model_cycles": model["cycles"], "cycles_error": "",
+           "rtl_stall_fraction": "", "model_stall_fraction": "", "breakdown_error": "",
+           "rtl_latency_p50": rtl["latency_p50"], "model_latency_p50": model["latency_p50"],
+           "rtl_wall_time": rtl["wall_time"], "model_wall_time": model["wall_time"], "speedup": ""}
+    if rtl["cycles"] and model["cycles"]:
+        row["cycles_error"] = f"{100 * (model['cycles'] - rtl['cycles']) / rtl['cycles']:.2f}"
+        row["rtl_stall_fraction"] = f"{rtl['stall_cycles'] / rtl['cycles']:.4f}"
+        row["model_stall_fraction"] = f"{model['stall_cycles'] / model['cycles']:.4f}"
+    # Largest gap over the five categories, in percentage points
+    if rtl["breakdown"] and model["breakdown"]:
+        gap = max(abs(rtl["breakdown"].get(c, 0) - model["breakdown"].get(c, 0)) for c in CATEGORIES)
+        row["breakdown_error"] = f"{100 * gap:.2f}"
+    if rtl["wall_time"] > 0 and model["wall_time"] > 0:
+        row["speedup"] = f"{rtl['wall_time'] / model['wall_time']:.0f}"
+    return row
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cycle error of the C++ model (perf_model) against the verilated array")
+    parser.add_argument("--configs", type=sweep.parse_configs, default=sweep.parse_configs(
+                        "128x2x8,128x8x2,128x20x20,10x128x2,10x2x128"), help="ROWSxCOLSxK shapes")
+    parser.add_argument("--num-tests", type=sweep.int_list, default=[100], help="comma separated NUM_TESTS values")
+    parser.add_argument("--seeds", type=sweep.int_list, default=[1], help="comma separated SEED values")
+    parser.add_argument("--in-width", type=int, default=8)
+    parser.add_argument("--out-width", type=int, default=8)
+    parser.add_argument("--flavor", choices=["perf", "debug"], default="perf")
+    parser.add_argument("--threads", type=int, default=0, help="verilate each model with --threads")
+    parser.add_argument("--set", action="append", default=[], metavar="VAR=VALUE",
+                        help="make variable for the RTL builds, passed on to the model if it changes timing")
+    parser.add_argument("--run-args", action="append", default=None,
+                        help="plusargs for both, one traffic case per use (default: the bench default and "
+                             "\"+out_rdy=always\")")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="configs built/run in parallel")
+    parser.add_argument("--run-cycles", type=int, default=0, help="watchdog passed as +run_cycles=")
+    parser.add_argument("--timeout", type=float, default=None, help="wall clock limit per RTL run, seconds")
+    parser.add_argument("--rebuild", action="store_true", help="ignore cached RTL builds")
+    parser.add_argument("--model", default="obj_dir_model/perf_model", help="perf_model binary")
+    parser.add_argument("--max-error", type=float, default=0,
+                        help="fail if any |cycles error| exceeds this many percent (0: report only)")
+    parser.add_argument("--csv", default="model_check.csv")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.model):
+        sys.exit(f"ERROR: no model binary {args.model}, run make build_perf_model")
+    run_args = args.run_args if args.run_args is not None else ["", "+out_rdy=always"]
+
+    jobs = list(itertools.product(args.configs, args.num_tests, args.seeds))
+    points = [(job, ra) for ra in run_args for job in jobs]
+    os.makedirs(sweep.SWEEP_DIR, exist_ok=True)
+    newest_source = sweep.source_mtime()
+
+    print(f"Building {len(args.configs)} configs with {args.jobs} jobs")
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        binaries = dict(zip(args.configs, pool.map(lambda c: sweep.build(c, args, newest_source)[0], args.configs)))
+
+    # The bench logs are named by config, num_tests and seed, so the
+    # traffic cases run one after the other
+    print(f"Running {len(points)} points with {args.jobs} jobs")
+    rtl = []
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        for ra in run_args:
+            rtl += list(pool.map(lambda j: run_rtl(j, ra, binaries[j[0]], args), jobs))
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        model = list(pool.map(lambda p: run_model(p[0], p[1], args), points))
+
+    rows = [compare(job, ra, r, m, args) for (job, ra), r, m in zip(points, rtl, model)]
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=CSV_FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+
+    errors = []
+    for r in rows:
+        shape = f"{r['rows']}x{r['cols']}x{r['k']}"
+        if r["cycles_error"] == "":
+            print(f"{shape:<10} {r['run_args'] or '(default)':<18} rtl={r['rtl_status']} model={r['model_status']}")
+            continue
+        errors.append(abs(float(r["cycles_error"])))
+        print(f"{shape:<10} {r['run_args'] or '(default)':<18} cycles rtl={r['rtl_cycles']:<8} "
+              f"model={r['model_cycles']:<8} error={r['cycles_error']:>7}%  stall rtl={r['rtl_stall_fraction']} "
+              f"model={r['model_stall_fraction']}  breakdown={r['breakdown_error'] or '-'}pp  speedup={r['speedup']}x")
+
+    failed = len(errors) < len(rows) or any(r["rtl_status"] != "PASSED" or r["model_status"] != "PASSED" for r in rows)
+    if errors:
+        print(f"{len(errors)}/{len(rows)} compared, |cycles error| mean={sum(errors) / len(errors):.2f}% "
+              f"max={max(errors):.2f}%, report in {args.csv}")
+        failed = failed or (args.max_error > 0 and max(errors) > args.max_error)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
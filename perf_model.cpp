@@ -0,0 +1,296 @@
+// DESCRIPTION:  cycle-approximate performance model of systolic_array
+//======================================================================
+// Runs ArrayModel (perf_model.h) the way test_systolic_array.cpp runs
+// the verilated array: the same job layout, the same seeded traffic on
+// the AXI stream ports, the same cycle accounting. The array shape and
+// every timing parameter are plusargs, so nothing is rebuilt per shape.
+// The summary uses the keys of the bench (Cycles=, StallCycles=, the
+// utilization breakdown and the latency line), which model_check.py
+// compares against the RTL.
+//
+//   +rows= +cols= +k= +mult_lat= +acc_lat= +mac_fifo_depth=
+//   +in_fifo_depth= +out_fifo_depth= +drain_lanes= +credit_flow=
+//   +registered_stall= +input_skew= +result_capture=
+//
+// plus the run arguments of the bench: +num_tests= +seed= +job_k=
+// +out_rdy= +a_vld= +b_vld= +traffic_seed= +credit_latency=
+// +run_cycles= +latency_bins= +latency_json=
+//======================================================================
+#include <iostream>
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "perf_model.h"
+#include "tb_latency.h"
+#include "tb_traffic.h"
+
+// Watchdog, in clock cycles (+run_cycles=)
+#define RUN_CYCLES 10000000
+
+// Default traffic on the AXI stream ports, as in the bench
+#define OUT_RDY_TRAFFIC "duty:0.333"
+#define IN_VLD_TRAFFIC  "always"
+
+// Plusargs without Verilated: value of "+name=value", or def if absent
+static int    g_argc;
+static char** g_argv;
+
+std::string arg_str(const char* name, const std::string& def) {
+    for (int i = 1; i < g_argc; i++) {
+        if (g_argv[i][0] == '+' && std::strncmp(g_argv[i] + 1, name, std::strlen(name)) == 0)
+            return std::string(g_argv[i] + 1 + std::strlen(name));
+    }
+    return def;
+}
+
+uint64_t arg_u64(const char* name, uint64_t def) {
+    std::string value = arg_str(name, "");
+    return value.empty() ? def : std::strtoull(value.c_str(), nullptr, 0);
+}
+
+std::vector<int> arg_int_list(const char* name) {
+    std::vector<int> values;
+    std::string value = arg_str(name, "");
+    for (size_t pos = 0; pos < value.size();) {
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos) end = value.size();
+        values.push_back((int)std::strtol(value.substr(pos, end - pos).c_str(), nullptr, 0));
+        pos = end + 1;
+    }
+    return values;
+}
+
+// Beat layout of SkewedStimulus without the data: tests back to back
+// along K, then max(rows, cols) padding beats unless the array skews.
+// Beats are asked about in increasing order.
+class JobStream {
+public:
+    JobStream(int k, const std::vector<int>& job_k, uint64_t num_tests, uint64_t padding)
+        : k_(k), job_k_(job_k), num_tests_(num_tests) {
+        for (uint64_t n = 0; n < num_tests; n++) steps_ += job_k_of(n);
+        total_ = steps_ + padding;
+    }
+
+    uint64_t total() const { return total_; }
+    uint64_t steps() const { return steps_; }
+
+    // First and last beat of a test, never set on the padding
+    bool rst_accumulator(uint64_t beat) { return seek(beat) && beat == start_; }
+    bool stream_out(uint64_t beat)      { return seek(beat) && beat == start_ + job_k_of(test_) - 1; }
+    uint64_t test() const               { return test_; }
+
+private:
+    int job_k_of(uint64_t n) const { return job_k_.empty() ? k_ : job_k_[n % job_k_.size()]; }
+
+    bool seek(uint64_t beat) {
+        while (test_ < num_tests_ && beat >= start_ + job_k_of(test_)) {
+            start_ += job_k_of(test_);
+            test_++;
+        }
+        return test_ < num_tests_;
+    }
+
+    int k_;
+    std::vector<int> job_k_;
+    uint64_t num_tests_;
+    uint64_t steps_  = 0;
+    uint64_t total_  = 0;
+    uint64_t test_   = 0;
+    uint64_t start_  = 0;
+};
+
+// Utilization breakdown; the five categories partition the cycles
+void print_utilization(const ModelCounters& p) {
+    std::cout << "Utilization over " << p.cycles << " cycles:" << std::endl;
+    auto line = [&](const char* name, uint64_t n) {
+        std::cout << "  " << std::left << std::setw(10) << name << std::right << std::setw(12) << n
+                  << std::fixed << std::setprecision(1) << std::setw(8)
+                  << (p.cycles ? 100.0 * n / p.cycles : 0.0) << "%" << std::endl;
+    };
+    line("active", p.active);
+    line("out_stall", p.out_stall);
+    line("mac_stall", p.mac_stall);
+    line("starve_a", p.starve_a);
+    line("starve_b", p.starve_b);
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    std::cout << "PerfOutBeats=" << p.out_beats << std::endl;
+}
+
+int main(int argc, char** argv) {
+    g_argc = argc;
+    g_argv = argv;
+
+    ModelConfig cfg;
+    cfg.rows             = (int)arg_u64("rows=", cfg.rows);
+    cfg.cols             = (int)arg_u64("cols=", cfg.cols);
+    cfg.k                = (int)arg_u64("k=", cfg.k);
+    cfg.mult_lat         = (int)arg_u64("mult_lat=", cfg.mult_lat);
+    cfg.acc_lat          = (int)arg_u64("acc_lat=", cfg.acc_lat);
+    cfg.mac_fifo_depth   = (int)arg_u64("mac_fifo_depth=", cfg.mac_fifo_depth);
+    cfg.in_fifo_depth    = (int)arg_u64("in_fifo_depth=", cfg.in_fifo_depth);
+    cfg.out_fifo_depth   = (int)arg_u64("out_fifo_depth=", cfg.out_fifo_depth);
+    cfg.drain_lanes      = (int)arg_u64("drain_lanes=", cfg.drain_lanes);
+    cfg.credit_flow      = arg_u64("credit_flow=", cfg.credit_flow) != 0;
+    cfg.registered_stall = arg_u64("registered_stall=", cfg.registered_stall) != 0;
+    cfg.result_capture   = arg_u64("result_capture=", cfg.result_capture) != 0;
+    const bool input_skew = arg_u64("input_skew=", 1) != 0;
+
+    ArrayModel model(cfg);
+    const std::string bad = model.check();
+    if (!bad.empty()) {
+        std::cerr << "ERROR: " << bad << std::endl;
+        exit(1);
+    }
+
+    const uint64_t num_tests  = arg_u64("num_tests=", 1);
+    const uint64_t seed       = arg_u64("seed=", 1);
+    const uint64_t run_cycles = arg_u64("run_cycles=", RUN_CYCLES);
+    const std::vector<int> job_k = arg_int_list("job_k=");
+    for (int k : job_k) {
+        if (k < cfg.k) {
+            std::cerr << "ERROR: +job_k= value " << k << " is below K=" << cfg.k << std::endl;
+            exit(1);
+        }
+    }
+    const uint64_t beats_per_test = cfg.cols / cfg.drain_lanes;
+    const uint64_t expected_beats = beats_per_test * num_tests;
+
+    JobStream jobs(cfg.k, job_k, num_tests, input_skew ? 0 : std::max(cfg.rows, cfg.cols));
+    LatencyTracker latency((int)arg_u64("latency_bins=", 20));
+    const std::string latency_json = arg_str("latency_json=", "");
+
+    // Same generators and seeds as the bench, so both see the same traffic
+    const uint64_t traffic_seed = arg_u64("traffic_seed=", seed);
+    std::unique_ptr<Traffic> out_rdy = make_traffic(arg_str("out_rdy=", OUT_RDY_TRAFFIC), traffic_seed, "+out_rdy");
+    std::unique_ptr<Traffic> a_vld   = make_traffic(arg_str("a_vld=", IN_VLD_TRAFFIC), traffic_seed + 1, "+a_vld");
+    std::unique_ptr<Traffic> b_vld   = make_traffic(arg_str("b_vld=", IN_VLD_TRAFFIC), traffic_seed + 2, "+b_vld");
+
+    const int credit_latency = (int)arg_u64("credit_latency=", 0);
+    CreditLink a_credits(cfg.in_fifo_depth, credit_latency);
+    CreditLink b_credits(cfg.in_fifo_depth, credit_latency);
+
+    bool a_sent = false;
+    bool b_sent = false;
+
+    uint64_t cycles          = 0;
+    uint64_t beat_a          = 0;
+    uint64_t beat_b          = 0;
+    uint64_t beats_out       = 0;
+    uint64_t stall_cycles    = 0;
+    uint64_t first_in_cycle  = 0;
+    uint64_t last_out_cycle  = 0;
+    bool     first_in_seen   = false;
+    bool     done            = false;
+    bool     failed          = false;
+    ModelCounters perf_start;
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    model.eval();
+    while (cycles < run_cycles && !done && !failed) {
+        model.tick();
+        // Counters from here on cover the edges after the first beat's,
+        // the same span as Cycles
+        if (first_in_seen && cycles == first_in_cycle) perf_start = model.counters();
+
+        // Host side of the bench, right after the rising edge
+        const bool a_hold = model.row_data_in_vld && !a_sent;
+        const bool b_hold = model.col_data_in_vld && !b_sent;
+        bool a_want = a_vld->next();
+        bool b_want = b_vld->next();
+        if (cfg.credit_flow) {
+            a_credits.tick(model.row_data_in_credit());
+            b_credits.tick(model.col_data_in_credit());
+            a_want = a_want && a_credits.available();
+            b_want = b_want && b_credits.available();
+        }
+
+        if (a_sent) beat_a++;
+        if (b_sent) beat_b++;
+        model.flush = beat_a >= jobs.total() && beat_b >= jobs.total();
+
+        model.row_data_in_vld = beat_a < jobs.total() && (a_hold || a_want);
+        if (model.row_data_in_vld) model.stream_out_rdy = jobs.stream_out(beat_a);
+        model.col_data_in_vld = beat_b < jobs.total() && (b_hold || b_want);
+
+        if (cfg.credit_flow) {
+            a_sent = model.row_data_in_vld;
+            b_sent = model.col_data_in_vld;
+            if (a_sent) a_credits.spend();
+            if (b_sent) b_credits.spend();
+            if ((a_sent && !model.row_data_in_rdy()) || (b_sent && !model.col_data_in_rdy())) {
+                std::cout << "FAILED! input fifo overrun with credits at cycle " << cycles << std::endl;
+                failed = true;
+            }
+        } else {
+            a_sent = model.row_data_in_vld && model.row_data_in_rdy();
+            b_sent = model.col_data_in_vld && model.col_data_in_rdy();
+        }
+        if (a_sent && jobs.rst_accumulator(beat_a)) {
+            latency.admit(jobs.test(), cycles + 1);
+        }
+        if (a_sent && !first_in_seen) {
+            first_in_cycle = cycles + 1;
+            first_in_seen  = true;
+        }
+
+        model.row_data_out_rdy = out_rdy->next();
+        if (model.row_data_out_vld() && model.row_data_out_rdy) {
+            if (++beats_out % beats_per_test == 0) {
+                latency.complete(beats_out / beats_per_test - 1, cycles + 1);
+            }
+            if (beats_out == expected_beats) {
+                last_out_cycle = cycles + 1;
+                done = true;
+            }
+        }
+
+        model.eval();
+        if (first_in_seen && model.stall()) stall_cycles++;
+
+        cycles++;
+    }
+
+    // Clock in the last accepted beat so the counters cover it too
+    if (done) model.tick();
+    const ModelCounters perf = model.counters() - perf_start;
+
+    double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    if (!done && !failed) {
+        std::cerr << "ERROR: timed out after " << cycles << " cycles with "
+                  << beats_out << "/" << expected_beats << " output beats" << std::endl;
+    }
+
+    std::cout << "Build=model" << std::endl;
+    std::cout << "Dataflow=output_stationary" << std::endl;
+    std::cout << "Cycles=" << (done ? last_out_cycle - first_in_cycle : cycles) << std::endl;
+    std::cout << "Beats=" << beats_out << "/" << expected_beats << std::endl;
+    std::cout << "StallCycles=" << stall_cycles << std::endl;
+    std::cout << "InputBeatsA=" << beat_a << std::endl;
+    std::cout << "InputBeatsB=" << beat_b << std::endl;
+    std::cout << "MACs=" << (uint64_t)cfg.rows * cfg.cols * jobs.steps() << std::endl;
+    std::cout << "WallTime=" << wall_time << "s" << std::endl;
+    std::cout << "CyclesPerSec=" << (wall_time > 0 ? cycles / wall_time : 0) << std::endl;
+    print_utilization(perf);
+    latency.report(std::cout);
+    if (!latency_json.empty() && !latency.write_json(latency_json)) {
+        std::cerr << "ERROR: cannot write " << latency_json << std::endl;
+    }
+
+    // Nothing to check but that every result left the array
+    if (done && !failed) {
+        std::cout << "PASSED! " << num_tests << " tests" << std::endl;
+    } else if (!failed) {
+        std::cout << "FAILED!" << std::endl;
+    }
+
+    exit(done && !failed ? 0 : 1);
+}
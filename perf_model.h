@@ -0,0 +1,360 @@
+// DESCRIPTION:  cycle-approximate performance model of systolic_array
+//======================================================================
+// ArrayModel follows the flow control of systolic_array.v cycle by
+// cycle without any of its data: occupancies instead of fifos, step
+// numbers instead of the ctrl delay lines. It has the ports of the
+// verilated model that matter for timing, so a bench drives it the way
+// test_systolic_array.cpp drives the RTL: set the inputs after a rising
+// edge, eval(), read stall(), tick() for the next edge.
+//
+// What is modelled, per cycle:
+//   - the input fifos: occupancy, the half full (or credit) accept rule,
+//     almost_empty starvation and the stream_out bit of every beat
+//   - ctrl: a job ends at the array step its stream_out beat is read;
+//     column c captures its sum MULT_LAT+ACC_LAT+c+2 steps later, every
+//     drain group is released on the step of the last column, and row r
+//     does both r steps after row 0
+//   - every MAC's result queue and released count, and the full flag a
+//     capture raises on a full queue (or almost full, with a skid)
+//   - the bypass drain: a released group of DRAIN_COLS columns puts one
+//     value per cycle into its output fifo, frozen by the read stall
+//   - the output fifos: half full (or almost full) stall flags, and a
+//     read when the consumer is ready and every lane holds a result
+//   - stall as the OR of the three, or 3 cycles late with REGISTERED_STALL
+//
+// Datapath latencies inside the MAC never hold the array, so they only
+// show up through the ctrl taps. Results are not computed. The counters
+// split the cycles like the perf_* outputs of the RTL.
+//======================================================================
+#ifndef PERF_MODEL_H
+#define PERF_MODEL_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+// systolic_array parameters that change timing, defaults as in the Makefile
+struct ModelConfig {
+    int  rows             = 4;
+    int  cols             = 5;
+    int  k                = 20;   // shortest job K
+    int  mult_lat         = 3;
+    int  acc_lat          = 1;
+    int  mac_fifo_depth   = 2;
+    int  in_fifo_depth    = 8;
+    int  out_fifo_depth   = 0;
+    int  drain_lanes      = 1;
+    bool credit_flow      = false;
+    bool registered_stall = false;
+    bool result_capture   = true;
+};
+
+// Same partition of the cycles as the perf_* counters of systolic_array
+struct ModelCounters {
+    uint64_t cycles = 0, active = 0, out_stall = 0, mac_stall = 0, starve_a = 0, starve_b = 0, out_beats = 0;
+
+    ModelCounters operator-(const ModelCounters& o) const {
+        ModelCounters d;
+        d.cycles    = cycles - o.cycles;
+        d.active    = active - o.active;
+        d.out_stall = out_stall - o.out_stall;
+        d.mac_stall = mac_stall - o.mac_stall;
+        d.starve_a  = starve_a - o.starve_a;
+        d.starve_b  = starve_b - o.starve_b;
+        d.out_beats = out_beats - o.out_beats;
+        return d;
+    }
+};
+
+class ArrayModel {
+public:
+    // Inputs, as the ports of systolic_array
+    bool flush            = false;
+    bool row_data_in_vld  = false;
+    bool stream_out_rdy   = false;   // sideband of the row_data_in beat
+    bool col_data_in_vld  = false;
+    bool row_data_out_rdy = false;
+
+    explicit ArrayModel(const ModelConfig& cfg) : cfg_(cfg) {
+        stall_delay_ = cfg.registered_stall ? 3 : 0;
+        drain_cols_  = cfg.cols / std::max(cfg.drain_lanes, 1);
+        in_cap_      = pow2(cfg.in_fifo_depth + 2 * stall_delay_);
+        out_slack_   = cfg.mult_lat + cfg.acc_lat + cfg.cols * cfg.rows / cfg.k + stall_delay_;
+        out_cap_     = pow2(cfg.out_fifo_depth != 0 ? cfg.out_fifo_depth : 2 * out_slack_);
+
+        // ctrl taps, in array steps after the step that read the stream_out
+        // beat: one step into the delay line, one through the tap register
+        const int base = cfg.mult_lat + cfg.acc_lat + 2;
+        for (int c = 0; c < cfg.cols; c++) {
+            capture_tap_.push_back(base + (cfg.result_capture ? c : cfg.cols - 1));
+            int hold = cfg.result_capture ? (cfg.cols - 1 - c + cfg.k - 1) / cfg.k : 0;
+            queue_cap_.push_back(pow2(cfg.mac_fifo_depth + hold + stall_delay_));
+        }
+        for (int g = 0; g < cfg.drain_lanes; g++)
+            release_tap_.push_back(base + cfg.cols - 1);
+        last_tap_ = std::max(capture_tap_.back(), release_tap_.back()) + cfg.rows - 1;
+
+        queue_.assign((size_t)cfg.rows * cfg.cols, 0);
+        released_.assign((size_t)cfg.rows * cfg.drain_lanes, 0);
+        counter_.assign((size_t)cfg.rows * cfg.drain_lanes, 0);
+        out_vld_.assign((size_t)cfg.rows * cfg.drain_lanes, false);
+        out_.assign((size_t)cfg.rows * cfg.drain_lanes, 0);
+        out_empty_ = (int)out_.size();
+        stall_pipe_.assign(stall_delay_, false);
+        read_stall_pipe_.assign(stall_delay_, false);
+        cause_pipe_.assign(stall_delay_, CAUSE_STARVE_B);
+    }
+
+    // Empty if the RTL would elaborate these parameters, else why not
+    std::string check() const {
+        if (cfg_.rows < 1 || cfg_.cols < 1 || cfg_.k < 1) return "ROWS, COLS and K must be at least 1";
+        if (cfg_.drain_lanes < 1 || cfg_.cols % cfg_.drain_lanes != 0) return "DRAIN_LANES must divide COLS";
+        if (cfg_.in_fifo_depth < 2) return "IN_FIFO_DEPTH must be at least 2";
+        if (cfg_.credit_flow ? out_cap_ <= out_slack_ : out_cap_ / 2 < out_slack_)
+            return "OUT_FIFO_DEPTH too small for " + std::to_string(out_slack_) + " results in flight";
+        return "";
+    }
+
+    // Registered outputs, valid right after tick()
+    bool row_data_in_rdy()  const { return accept(in_a_); }
+    bool col_data_in_rdy()  const { return accept(in_b_); }
+    bool row_data_in_credit() const { return cfg_.credit_flow && credit_; }
+    bool col_data_in_credit() const { return cfg_.credit_flow && credit_; }
+    bool row_data_out_vld() const { return out_empty_ == 0; }
+
+    // Combinational signals of the cycle, from the state and the inputs
+    void eval() {
+        const bool out_flag = out_flagged_ > 0;
+        mac_flag_           = mac_full_flag();
+        const bool starved  = in_a_ <= stall_delay_ || in_b_ <= stall_delay_;
+        const bool cond     = out_flag || mac_flag_ || (!flush && starved);
+        const Cause cause   = out_flag ? CAUSE_OUT : mac_flag_ ? CAUSE_MAC
+                            : in_a_ <= stall_delay_ ? CAUSE_STARVE_A : CAUSE_STARVE_B;
+        if (stall_delay_) {
+            stall_       = stall_pipe_.front();
+            read_stall_  = read_stall_pipe_.front();
+            stall_cause_ = cause_pipe_.front();
+            next_cond_      = cond;
+            next_read_cond_ = out_flag;
+            next_cause_     = cause;
+        } else {
+            stall_       = cond;
+            read_stall_  = out_flag;
+            stall_cause_ = cause;
+        }
+        read_ = in_a_ > 0 && in_b_ > 0 && !stall_;
+    }
+
+    bool stall() const { return stall_; }
+
+    // Rising edge, with the inputs and the eval() of the cycle it ends
+    void tick() {
+        // Perf counters, priorities as in the RTL: a stalled cycle goes to
+        // the flags its stall was built from
+        counters_.cycles++;
+        if (read_) {
+            counters_.active++;
+        } else if (stall_ && stall_cause_ == CAUSE_OUT) {
+            counters_.out_stall++;
+        } else if (stall_ && stall_cause_ == CAUSE_MAC) {
+            counters_.mac_stall++;
+        } else if (stall_ ? stall_cause_ == CAUSE_STARVE_A : in_a_ == 0) {
+            counters_.starve_a++;
+        } else {
+            counters_.starve_b++;
+        }
+
+        // Output side first: it works on the state the cycle started with
+        const bool out_read = row_data_out_rdy && row_data_out_vld();
+        drain();
+        if (out_read) {
+            for (size_t i = 0; i < out_.size(); i++) out_pop(i);
+            counters_.out_beats++;
+        }
+
+        // Input fifos, and the job whose stream_out beat the array takes
+        const bool a_write = row_data_in_vld && accept(in_a_);
+        const bool b_write = col_data_in_vld && accept(in_b_);
+        if (read_) {
+            if (stream_out_.front()) jobs_.push_back(step_ + 1);
+            stream_out_.pop_front();
+            in_a_--;
+            in_b_--;
+        }
+        if (a_write) {
+            stream_out_.push_back(stream_out_rdy);
+            in_a_++;
+        }
+        if (b_write) in_b_++;
+        credit_ = read_;
+
+        // One array step: captures and releases of the ctrl taps
+        if (!stall_) {
+            step_++;
+            for (uint64_t end : jobs_) step_job(end);
+            while (!jobs_.empty() && step_ > jobs_.front() + last_tap_) jobs_.pop_front();
+        }
+
+        if (stall_delay_) {
+            stall_pipe_.pop_front();
+            stall_pipe_.push_back(next_cond_);
+            read_stall_pipe_.pop_front();
+            read_stall_pipe_.push_back(next_read_cond_);
+            cause_pipe_.pop_front();
+            cause_pipe_.push_back(next_cause_);
+        }
+    }
+
+    const ModelCounters& counters() const { return counters_; }
+
+private:
+    // What raised a stall, in the order the perf counters check it
+    enum Cause { CAUSE_OUT, CAUSE_MAC, CAUSE_STARVE_A, CAUSE_STARVE_B };
+
+    static int pow2(int n) {
+        int p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // Beat taken on the next edge: below half full, or not full with credits
+    bool accept(int count) const {
+        return cfg_.credit_flow ? count < in_cap_ : (count & (in_cap_ - 1)) < in_cap_ / 2;
+    }
+
+    bool out_flag(int count) const {
+        return cfg_.credit_flow ? count >= out_cap_ - out_slack_ : (count & (out_cap_ - 1)) >= out_cap_ / 2;
+    }
+
+    // Any capture of this step hitting a full queue; with a skid, any queue almost full
+    bool mac_full_flag() const {
+        if (stall_delay_) return queues_almost_full_ > 0;
+        for (uint64_t end : jobs_) {
+            // Captures of one step lie on an anti-diagonal r + c
+            int64_t d = (int64_t)(step_ + 1) - (int64_t)(end + capture_tap_[0]);
+            if (d < 0) continue;
+            if (!cfg_.result_capture) {
+                if (d < cfg_.rows) {
+                    for (int c = 0; c < cfg_.cols; c++)
+                        if (queue_[(size_t)d * cfg_.cols + c] >= queue_cap_[c]) return true;
+                }
+                continue;
+            }
+            for (int r = std::max<int64_t>(0, d - cfg_.cols + 1); r < cfg_.rows && r <= d; r++) {
+                int c = (int)(d - r);
+                if (queue_[(size_t)r * cfg_.cols + c] >= queue_cap_[c]) return true;
+            }
+        }
+        return false;
+    }
+
+    void push_queue(int r, int c) {
+        int& q = queue_[(size_t)r * cfg_.cols + c];
+        if (q >= queue_cap_[c]) return;
+        q++;
+        if (q == queue_cap_[c] - stall_delay_) queues_almost_full_++;
+    }
+
+    void pop_queue(int r, int c) {
+        int& q = queue_[(size_t)r * cfg_.cols + c];
+        if (q == queue_cap_[c] - stall_delay_) queues_almost_full_--;
+        q--;
+    }
+
+    // Captures and releases of job `end` at the step just taken
+    void step_job(uint64_t end) {
+        const uint64_t s = step_;
+        // Captures: row r, column c with end + tap(c) + r == s
+        if (cfg_.result_capture) {
+            int64_t d = (int64_t)s - (int64_t)(end + capture_tap_[0]);
+            if (d >= 0) {
+                for (int r = std::max<int64_t>(0, d - cfg_.cols + 1); r < cfg_.rows && r <= d; r++)
+                    push_queue(r, (int)(d - r));
+            }
+        } else if (s >= end + capture_tap_[0] && s < end + capture_tap_[0] + cfg_.rows) {
+            int r = (int)(s - end - capture_tap_[0]);
+            for (int c = 0; c < cfg_.cols; c++) push_queue(r, c);
+        }
+        // Releases: row r, group g with end + tap(g) + r == s
+        for (int g = 0; g < cfg_.drain_lanes; g++) {
+            if (s < end + release_tap_[g] || s >= end + release_tap_[g] + cfg_.rows) continue;
+            int r = (int)(s - end - release_tap_[g]);
+            // drain() has already seen the count from before this release
+            released_[(size_t)r * cfg_.drain_lanes + g]++;
+        }
+    }
+
+    // Bypass drain of every (row, group), then the output fifo writes
+    void drain() {
+        if (read_stall_) return;
+        for (int r = 0; r < cfg_.rows; r++) {
+            for (int g = 0; g < cfg_.drain_lanes; g++) {
+                size_t i = (size_t)r * cfg_.drain_lanes + g;
+                // psum_out of the group's first column feeds the output fifo
+                if (out_vld_[i] && out_[i] < out_cap_) out_push(i);
+                if (counter_[i] != 0) {
+                    out_vld_[i] = true;
+                    counter_[i] = counter_[i] == drain_cols_ - 1 ? 0 : counter_[i] + 1;
+                } else if (released_[i] != 0) {
+                    // drain_start: every column of the group pops its oldest psum
+                    for (int c = g * drain_cols_; c < (g + 1) * drain_cols_; c++) pop_queue(r, c);
+                    released_[i]--;
+                    out_vld_[i] = true;
+                    counter_[i] = drain_cols_ > 1 ? 1 : 0;
+                } else {
+                    out_vld_[i] = false;
+                }
+            }
+        }
+    }
+
+    void out_push(size_t i) {
+        bool was = out_flag(out_[i]);
+        if (out_[i]++ == 0) out_empty_--;
+        out_flagged_ += (int)out_flag(out_[i]) - (int)was;
+    }
+
+    void out_pop(size_t i) {
+        bool was = out_flag(out_[i]);
+        if (--out_[i] == 0) out_empty_++;
+        out_flagged_ += (int)out_flag(out_[i]) - (int)was;
+    }
+
+    ModelConfig cfg_;
+    int stall_delay_, drain_cols_, in_cap_, out_slack_, out_cap_;
+    std::vector<int> capture_tap_;   // per column
+    std::vector<int> release_tap_;   // per drain group
+    std::vector<int> queue_cap_;     // per column
+    int last_tap_;
+
+    // Input fifos: occupancy and the stream_out bit of every A beat
+    int in_a_ = 0, in_b_ = 0;
+    std::deque<bool> stream_out_;
+    bool credit_ = false;
+
+    // Array steps taken, and the step after each unfinished job's stream_out beat
+    uint64_t step_ = 0;
+    std::deque<uint64_t> jobs_;
+
+    std::vector<int>  queue_;      // per MAC: psums in the result queue
+    std::vector<int>  released_;   // per (row, group): released psums still queued
+    std::vector<int>  counter_;    // per (row, group): bypass_counter
+    std::vector<bool> out_vld_;    // per (row, group): psum_out_vld of the first column
+    std::vector<int>  out_;        // per (row, lane): output fifo occupancy
+    int out_empty_          = 0;
+    int out_flagged_        = 0;
+    int queues_almost_full_ = 0;
+
+    // This cycle's combinational values, and the registered stall pipeline
+    bool stall_ = false, read_stall_ = false, read_ = false, mac_flag_ = false;
+    bool next_cond_ = false, next_read_cond_ = false;
+    Cause stall_cause_ = CAUSE_STARVE_B, next_cause_ = CAUSE_STARVE_B;
+    std::deque<bool> stall_pipe_, read_stall_pipe_;
+    std::deque<Cause> cause_pipe_;
+
+    ModelCounters counters_;
+};
+
+#endif // PERF_MODEL_H
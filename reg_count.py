@@ -0,0 +1,88 @@
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+from collections import defaultdict
+
+
+
+# Cells inside the MAC grid, after flattening
+MAC_CELL = re.compile(r"instantiate_mac_cols\[\d+\]\.mac\.")
+
+SOURCES = ["systolic_array.v", "MAC.v", "ctrl.v", "skew.v", "adder.v", "multiplier.v", "synchronus_fifo.v"]
+
+
+def elaborate(args, capture, json_path):
+    """
+    Flattens systolic_array with yosys without mapping, so every register is
+    still one $*dff* cell of WIDTH bits and every fifo one $mem cell
+    """
+    params = {"ROWS": args.rows, "COLS": args.cols, "K": args.k, "MAC_FIFO_DEPTH": args.mac_fifo_depth,
+              "DRAIN_LANES": args.drain_lanes, "RESULT_CAPTURE": capture}
+    chparam = " ".join(f"-set {name} {value}" for name, value in params.items())
+    script = (f"read_verilog -sv {' '.join(SOURCES)}; "
+              f"chparam {chparam} systolic_array; "
+              f"hierarchy -top systolic_array; proc; flatten; opt_clean; memory -nomap; opt_clean; "
+              f"write_json {json_path}")
+    with open(json_path + ".log", "w") as log:
+        status = subprocess.call([args.yosys, "-q", "-p", script], stdout=log, stderr=subprocess.STDOUT)
+    if status != 0:
+        sys.exit(f"ERROR: yosys failed, see {json_path}.log")
+
+
+def param(value):
+    # yosys writes parameters as binary strings, or as ints in older versions
+    return int(value, 2) if isinstance(value, str) else int(value)
+
+
+def count(json_path):
+    """
+    Register and memory bits, in the MAC grid and in the rest of the array
+    """
+    with open(json_path) as f:
+        module = json.load(f)["modules"]["systolic_array"]
+
+    bits = defaultdict(int)
+    for name, cell in module["cells"].items():
+        where = "mac" if MAC_CELL.search(name) else "other"
+        if "dff" in cell["type"]:
+            bits[where] += param(cell["parameters"]["WIDTH"])
+        elif cell["type"].startswith("$mem"):
+            bits[where] += param(cell["parameters"]["WIDTH"]) * param(cell["parameters"]["SIZE"])
+    return bits
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Register bits of systolic_array, psum delay line vs result capture")
+    parser.add_argument("--rows", type=int, default=10)
+    parser.add_argument("--cols", type=int, default=128)
+    parser.add_argument("--k", type=int, default=2)
+    parser.add_argument("--mac-fifo-depth", type=int, default=2)
+    parser.add_argument("--drain-lanes", type=int, default=1)
+    parser.add_argument("--yosys", default="yosys")
+    parser.add_argument("--out-dir", default="obj_dir_regs")
+    parser.add_argument("--report", default="reg_count.log")
+    args = parser.parse_args()
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    lines = [f"Register bits of systolic_array ROWS={args.rows} COLS={args.cols} K={args.k}"
+             f" MAC_FIFO_DEPTH={args.mac_fifo_depth} DRAIN_LANES={args.drain_lanes}",
+             f"{'RESULT_CAPTURE':<16}{'MAC grid':>12}{'per MAC':>10}{'rest':>10}{'total':>12}"]
+    for capture in (0, 1):
+        json_path = os.path.join(args.out_dir, f"R{args.rows}_C{args.cols}_K{args.k}_L{args.drain_lanes}"
+                                               f"_d{args.mac_fifo_depth}_cap{capture}.json")
+        elaborate(args, capture, json_path)
+        bits = count(json_path)
+        per_mac = bits["mac"] / (args.rows * args.cols)
+        lines.append(f"{capture:<16}{bits['mac']:>12}{per_mac:>10.1f}{bits['other']:>10}"
+                     f"{bits['mac'] + bits['other']:>12}")
+
+    with open(args.report, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    print("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,17 +1,3 @@
-rm -rf 01.txt 02.txt 03.txt 04.txt 05.txt 06.txt 07.txt 08.txt 09.txt 10.txt 11.txt 12.txt 13.txt 14.txt
-
-	make systolic_array ROWS=128 COLS=2 K=8 NUM_TESTS=100
-	cat results.log | grep PASSED >> 01.txt
-
-	make systolic_array ROWS=128 COLS=8 K=2 NUM_TESTS=100
-	cat results.log | grep PASSED >> 02.txt
-
-	make systolic_array ROWS=128 COLS=20 K=20 NUM_TESTS=100
-	cat results.log | grep PASSED >> 03.txt
-
-	make systolic_array ROWS=10 COLS=128 K=2 NUM_TESTS=100
-	cat results.log | grep PASSED >> 04.txt
-
-	make systolic_array ROWS=10 COLS=2 K=128 NUM_TESTS=100
-	cat results.log | grep PASSED >> 05.txt
-
+# Qualification sweep: every shape is built once into obj_dir_sweep/ and the
+# shapes run in parallel; per-config results are collected in sweep.csv
+make sweep SWEEP_CONFIGS=128x2x8,128x8x2,128x20x20,10x128x2,10x2x128 SWEEP_NUM_TESTS=100
@@ -0,0 +1,52 @@
+module skew #(
+    parameter LANES      = 4,
+    parameter WIDTH      = 8,
+    parameter DESCENDING = 0    // 0: lane i delayed i cycles, 1: lane i delayed LANES-1-i cycles
+)(
+    input                    clk,
+    input                    rst,
+    input  [LANES-1:0]       en,  // per lane: shift when 1, hold when 0 (stall)
+    input  [LANES*WIDTH-1:0] data_in,
+    output [LANES*WIDTH-1:0] data_out
+);
+
+    // Staircase of delay lines: turns a dense beat into the diagonal
+    // wavefront a systolic array consumes (DESCENDING=0), or lines a
+    // wavefront back up into one beat (DESCENDING=1). Lane 0 (or LANES-1)
+    // passes straight through, so the staircase holds LANES*(LANES-1)/2
+    // words in total. Each lane has its own enable, so a caller can
+    // drive them from separate copies of its stall.
+    genvar i, d;
+    generate
+        for (i = 0; i < LANES; i = i + 1) begin: lane
+            localparam DELAY = DESCENDING ? LANES - 1 - i : i;
+
+            if (DELAY == 0) begin: pass
+                assign data_out[i*WIDTH +: WIDTH] = data_in[i*WIDTH +: WIDTH];
+            end else begin: delay
+                reg [WIDTH-1:0] stage [0:DELAY-1];
+
+                always @(posedge clk) begin
+                    if (rst) begin
+                        stage[0] <= 0;
+                    end else if (en[i]) begin
+                        stage[0] <= data_in[i*WIDTH +: WIDTH];
+                    end
+                end
+
+                for (d = 1; d < DELAY; d = d + 1) begin: stages
+                    always @(posedge clk) begin
+                        if (rst) begin
+                            stage[d] <= 0;
+                        end else if (en[i]) begin
+                            stage[d] <= stage[d-1];
+                        end
+                    end
+                end
+
+                assign data_out[i*WIDTH +: WIDTH] = stage[DELAY-1];
+            end
+        end
+    endgenerate
+
+endmodule
@@ -0,0 +1,131 @@
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+from collections import defaultdict
+
+
+
+# Nets that make up the stall network: the reductions feeding stall, the stall
+# nets themselves and their per-row / per-column / per-MAC copies
+STALL_NET = re.compile(r"(^|\.)(stall|mac_read_stall|row_stall|row_read_stall|col_stall|flag_found|flat_array"
+                       r"|input_starved|row_mac_full_q|row_out_half_q|starve_q|stall_q|read_stall_q|row_stall_q"
+                       r"|row_read_stall_q|col_stall_q|edge_stall_q|edge_read_stall_q)$")
+
+SOURCES = ["systolic_array.v", "MAC.v", "ctrl.v", "skew.v", "adder.v", "multiplier.v", "synchronus_fifo.v"]
+
+
+def synthesize(args, registered, json_path):
+    """
+    Flattens and maps systolic_array to generic gates with yosys, netlist written as JSON
+    """
+    params = {"ROWS": args.rows, "COLS": args.cols, "K": args.k, "REGISTERED_STALL": registered}
+    chparam = " ".join(f"-set {name} {value}" for name, value in params.items())
+    script = (f"read_verilog -sv {' '.join(SOURCES)}; "
+              f"chparam {chparam} systolic_array; "
+              f"synth -flatten -top systolic_array; "
+              f"write_json {json_path}")
+    with open(json_path + ".log", "w") as log:
+        status = subprocess.call([args.yosys, "-q", "-p", script], stdout=log, stderr=subprocess.STDOUT)
+    if status != 0:
+        sys.exit(f"ERROR: yosys failed, see {json_path}.log")
+
+
+def is_sequential(cell_type):
+    return "DFF" in cell_type or "DLATCH" in cell_type or cell_type.startswith("$_SR") or cell_type.startswith("$mem")
+
+
+def analyze(json_path):
+    """
+    Logic depth counted in mapped gates. For every net bit the longest path
+    through it runs from a register/input to the bit (arrival) and on to a
+    register/output (departure). Returns the longest path through any stall
+    network bit, the largest fanout of a stall network bit, and the longest
+    path in the whole design for reference.
+    """
+    with open(json_path) as f:
+        module = json.load(f)["modules"]["systolic_array"]
+
+    driver = {}                  # bit -> comb cell driving it
+    cell_in = {}                 # comb cell -> input bits
+    cell_out = {}                # comb cell -> output bits
+    readers = defaultdict(list)  # bit -> comb cells reading it
+    fanout = defaultdict(int)    # bit -> number of cell inputs it feeds
+    for name, cell in module["cells"].items():
+        ins, outs = [], []
+        for port, bits in cell["connections"].items():
+            bits = [b for b in bits if isinstance(b, int)]
+            (outs if cell["port_directions"][port] == "output" else ins).extend(bits)
+        for b in ins:
+            fanout[b] += 1
+        if is_sequential(cell["type"]):
+            continue
+        cell_in[name], cell_out[name] = ins, outs
+        for b in outs:
+            driver[b] = name
+        for b in ins:
+            readers[b].append(name)
+
+    # Topological order of the comb cells (Kahn)
+    pending = {c: sum(1 for b in ins if b in driver) for c, ins in cell_in.items()}
+    order = [c for c, n in pending.items() if n == 0]
+    for c in order:
+        for b in cell_out[c]:
+            for r in readers[b]:
+                pending[r] -= 1
+                if pending[r] == 0:
+                    order.append(r)
+
+    arrival = defaultdict(int)
+    for c in order:
+        level = 1 + max((arrival[b] for b in cell_in[c]), default=0)
+        for b in cell_out[c]:
+            arrival[b] = level
+    departure = defaultdict(int)
+    for c in reversed(order):
+        level = 1 + max((departure[b] for b in cell_out[c]), default=0)
+        for b in cell_in[c]:
+            departure[b] = max(departure[b], level)
+
+    stall_bits = set()
+    for name, net in module["netnames"].items():
+        if STALL_NET.search(name):
+            stall_bits.update(b for b in net["bits"] if isinstance(b, int))
+
+    through = lambda b: arrival[b] + departure[b]
+    all_bits = set(arrival) | set(departure)
+    return {
+        "stall_depth":  max((through(b) for b in stall_bits), default=0),
+        "stall_fanout": max((fanout[b] for b in stall_bits), default=0),
+        "design_depth": max((through(b) for b in all_bits), default=0),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Logic depth of the systolic_array stall path, combinational vs registered")
+    parser.add_argument("--rows", type=int, default=128)
+    parser.add_argument("--cols", type=int, default=20)
+    parser.add_argument("--k", type=int, default=20)
+    parser.add_argument("--yosys", default="yosys")
+    parser.add_argument("--out-dir", default="obj_dir_stall")
+    parser.add_argument("--report", default="stall_depth.log")
+    args = parser.parse_args()
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    lines = [f"Stall path of systolic_array ROWS={args.rows} COLS={args.cols} K={args.k}, depth in mapped gates",
+             f"{'REGISTERED_STALL':<18}{'stall path depth':>18}{'max stall fanout':>18}{'design depth':>14}"]
+    for registered in (0, 1):
+        json_path = os.path.join(args.out_dir, f"R{args.rows}_C{args.cols}_K{args.k}_reg{registered}.json")
+        synthesize(args, registered, json_path)
+        r = analyze(json_path)
+        lines.append(f"{registered:<18}{r['stall_depth']:>18}{r['stall_fanout']:>18}{r['design_depth']:>14}")
+
+    with open(args.report, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    print("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
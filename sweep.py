@@ -0,0 +1,198 @@
+import argparse
+import csv
+import itertools
+import os
+import re
+import subprocess
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+
+
+# Sources the systolic_array bench is built from; a cached build older than any of them is rebuilt
+SOURCES = ["systolic_array.v", "MAC.v", "ctrl.v", "skew.v", "adder.v", "multiplier.v", "synchronus_fifo.v",
+           "test_systolic_array.cpp", "Makefile"]
+
+SWEEP_DIR = "obj_dir_sweep"
+
+CSV_FIELDS = ["rows", "cols", "k", "in_width", "out_width", "num_tests", "seed", "flavor", "settings",
+              "status", "cycles", "beats", "macs_per_cycle", "stall_cycles", "stall_fraction",
+              "latency_min", "latency_p50", "latency_p99", "latency_max", "wall_time", "cycles_per_sec", "log"]
+
+
+def int_list(text):
+    """
+    Parses a comma separated list of integers, e.g. "4,8,16"
+    """
+    return [int(v) for v in text.split(",") if v]
+
+
+def parse_configs(text):
+    """
+    Parses explicit "ROWSxCOLSxK" shapes, comma or space separated
+    """
+    configs = []
+    for shape in re.split(r"[,\s]+", text.strip()):
+        if not shape:
+            continue
+        parts = shape.lower().split("x")
+        if len(parts) != 3:
+            raise ValueError(f"Improper shape {shape}, expected ROWSxCOLSxK")
+        configs.append(tuple(int(p) for p in parts))
+    return configs
+
+
+def source_mtime():
+    files = list(SOURCES)
+    files += [f for f in os.listdir(".") if f.startswith("tb_") and f.endswith(".h")]
+    return max(os.path.getmtime(f) for f in files if os.path.exists(f))
+
+
+def build_dir(rows, cols, k, args):
+    name = f"R{rows}_C{cols}_K{k}_I{args.in_width}_O{args.out_width}_{args.flavor}"
+    for setting in args.set:
+        name += "_" + setting.replace("=", "")
+    return os.path.join(SWEEP_DIR, name)
+
+
+def build(config, args, newest_source):
+    """
+    Verilates and compiles one config into its own object directory, unless an
+    up to date binary built with the same make arguments is already there.
+    Returns (binary path or None, build log path).
+    """
+    rows, cols, k = config
+    obj_dir = build_dir(rows, cols, k, args)
+    binary  = os.path.join(obj_dir, "Vsystolic_array")
+    log     = obj_dir + ".build.log"
+    stamp   = os.path.join(obj_dir, "sweep.stamp")
+
+    if args.flavor == "perf":
+        make_args = ["build_systolic_array_perf", f"OBJ_DIR_PERF={obj_dir}"]
+    else:
+        # Debug flavor keeps the assertions; tracing and debug prints stay out of the timing
+        make_args = ["build_systolic_array", f"OBJ_DIR={obj_dir}", "TRACE_FMT=none", "CXXFLAGS="]
+    make_args += [f"ROWS={rows}", f"COLS={cols}", f"K={k}",
+                  f"IN_WIDTH={args.in_width}", f"OUT_WIDTH={args.out_width}"]
+    if args.threads:
+        make_args.append(f"THREADS={args.threads}")
+    make_args += args.set
+    signature = " ".join(make_args)
+
+    if not args.rebuild and os.path.exists(binary) and os.path.getmtime(binary) >= newest_source:
+        if os.path.exists(stamp) and open(stamp).read() == signature:
+            return binary, log
+
+    with open(log, "w") as f:
+        status = subprocess.call(["make", "-s"] + make_args, stdout=f, stderr=subprocess.STDOUT)
+    if status != 0 or not os.path.exists(binary):
+        return None, log
+    with open(stamp, "w") as f:
+        f.write(signature)
+    return binary, log
+
+
+def run(job, binary, args):
+    """
+    Runs one (config, num_tests, seed) point and parses the bench summary
+    """
+    (rows, cols, k), num_tests, seed = job
+    row = {"rows": rows, "cols": cols, "k": k, "in_width": args.in_width, "out_width": args.out_width,
+           "num_tests": num_tests, "seed": seed, "flavor": args.flavor, "settings": " ".join(args.set),
+           "status": "BUILD_FAILED", "cycles": "", "beats": "", "macs_per_cycle": "",
+           "stall_cycles": "", "stall_fraction": "", "latency_min": "", "latency_p50": "",
+           "latency_p99": "", "latency_max": "", "wall_time": "", "cycles_per_sec": "",
+           "log": ""}
+    if binary is None:
+        row["log"] = build_dir(rows, cols, k, args) + ".build.log"
+        return row
+
+    log = build_dir(rows, cols, k, args) + f".n{num_tests}_s{seed}.log"
+    cmd = [binary, f"+num_tests={num_tests}", f"+seed={seed}"]
+    if args.run_cycles:
+        cmd.append(f"+run_cycles={args.run_cycles}")
+    cmd += args.run_args.split()
+    try:
+        out = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True, timeout=args.timeout).stdout
+    except subprocess.TimeoutExpired as e:
+        out = (e.stdout or b"").decode() if isinstance(e.stdout, bytes) else (e.stdout or "")
+        out += "\nFAILED! sweep timeout\n"
+    with open(log, "w") as f:
+        f.write(out)
+    row["log"] = log
+
+    values = dict(re.findall(r"^(\w+)=(\S+)$", out, re.MULTILINE))
+    row["status"] = "PASSED" if re.search(r"^PASSED!", out, re.MULTILINE) else "FAILED"
+    if "Cycles" in values:
+        cycles = int(values["Cycles"])
+        row["cycles"] = cycles
+        macs = int(values.get("MACs", rows * cols * k * num_tests))
+        if cycles > 0:
+            row["macs_per_cycle"] = f"{macs / cycles:.4f}"
+        if "StallCycles" in values:
+            row["stall_cycles"] = int(values["StallCycles"])
+            if cycles > 0:
+                row["stall_fraction"] = f"{int(values['StallCycles']) / cycles:.4f}"
+    latency = re.search(r"^Latency over .* min=(\d+) p50=(\d+) p99=(\d+) max=(\d+)", out, re.MULTILINE)
+    if latency:
+        row["latency_min"], row["latency_p50"], row["latency_p99"], row["latency_max"] = latency.groups()
+    row["beats"] = values.get("Beats", "")
+    row["wall_time"] = values.get("WallTime", "").rstrip("s")
+    row["cycles_per_sec"] = values.get("CyclesPerSec", "")
+    return row
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Parallel parameter sweep of the systolic_array bench")
+    parser.add_argument("--rows", type=int_list, default=[4], help="comma separated ROWS values")
+    parser.add_argument("--cols", type=int_list, default=[5], help="comma separated COLS values")
+    parser.add_argument("--k", type=int_list, default=[20], help="comma separated K values")
+    parser.add_argument("--configs", type=parse_configs, default=None,
+                        help="explicit ROWSxCOLSxK shapes, replaces the --rows/--cols/--k grid")
+    parser.add_argument("--num-tests", type=int_list, default=[1], help="comma separated NUM_TESTS values")
+    parser.add_argument("--seeds", type=int_list, default=[1], help="comma separated SEED values")
+    parser.add_argument("--in-width", type=int, default=8)
+    parser.add_argument("--out-width", type=int, default=8)
+    parser.add_argument("--flavor", choices=["perf", "debug"], default="perf")
+    parser.add_argument("--threads", type=int, default=0, help="verilate each model with --threads")
+    parser.add_argument("--set", action="append", default=[], metavar="VAR=VALUE",
+                        help="extra make variable for every build, e.g. MAC_FIFO_DEPTH=4 (repeatable)")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="configs built/run in parallel")
+    parser.add_argument("--run-cycles", type=int, default=0, help="watchdog passed as +run_cycles=")
+    parser.add_argument("--run-args", default="", help="extra plusargs for every run, e.g. \"+out_rdy=duty:0.5\"")
+    parser.add_argument("--timeout", type=float, default=None, help="wall clock limit per run, seconds")
+    parser.add_argument("--rebuild", action="store_true", help="ignore cached builds")
+    parser.add_argument("--csv", default="sweep.csv")
+    args = parser.parse_args()
+
+    configs = args.configs or list(itertools.product(args.rows, args.cols, args.k))
+    jobs = list(itertools.product(configs, args.num_tests, args.seeds))
+    os.makedirs(SWEEP_DIR, exist_ok=True)
+    newest_source = source_mtime()
+
+    # Each config is built once; NUM_TESTS and SEED are run-time arguments
+    print(f"Building {len(configs)} configs with {args.jobs} jobs")
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        binaries = dict(zip(configs, pool.map(lambda c: build(c, args, newest_source)[0], configs)))
+
+    print(f"Running {len(jobs)} points with {args.jobs} jobs")
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        rows = list(pool.map(lambda j: run(j, binaries[j[0]], args), jobs))
+
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=CSV_FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+
+    failed = [r for r in rows if r["status"] != "PASSED"]
+    for r in rows:
+        print(f"{r['rows']}x{r['cols']}x{r['k']} n={r['num_tests']} seed={r['seed']}: {r['status']}"
+              f" cycles={r['cycles']} macs/cycle={r['macs_per_cycle']} stall={r['stall_fraction']}"
+              f" wall={r['wall_time']}")
+    print(f"{len(rows) - len(failed)}/{len(rows)} passed, report in {args.csv}")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
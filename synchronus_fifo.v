@@ -1,6 +1,9 @@
 module synchronous_fifo #(
   parameter               DEPTH       = 8,
-  parameter               DATA_WIDTH  = 8
+  parameter               DATA_WIDTH  = 8,
+  parameter               ALMOST_FULL_FREE = 0,  // almost_full once this many or fewer slots are free
+  parameter               ALMOST_EMPTY     = 0,  // almost_empty while this many or fewer entries are held
+  parameter               REGISTERED_FLAGS = 0   // If 1, almost_full/almost_empty come straight from flops
 ) (
   input                   clk,
   input                   rst_n,
@@ -10,7 +13,9 @@ module synchronous_fifo #(
   output [DATA_WIDTH-1:0] data_out,
   output                  full,
   output                  half_full,
-  output                  empty
+  output                  empty,
+  output                  almost_full,
+  output                  almost_empty
 );
   
   // Additional 1 bit for w_ptr, r_ptr to determine full/empty
@@ -29,6 +34,38 @@ module synchronous_fifo #(
   wire [$clog2(DEPTH)-1:0] difference = w_ptr[$clog2(DEPTH)-1:0] - r_ptr[$clog2(DEPTH)-1:0];
   assign half_full = difference >= half_size;
 
+  // Occupancy including the wrap bit, so a full fifo does not read as 0
+  localparam CAPACITY = 1 << $clog2(DEPTH);
+  wire [$clog2(DEPTH):0] count = w_ptr - r_ptr;
+
+  generate
+    if (REGISTERED_FLAGS) begin: registered_flags
+      // Flags of the occupancy after this edge's write and read: the same
+      // values as the combinational ones, but driven straight from flops
+      // instead of from the pointer subtract and compare
+      wire                   do_write   = w_en & !full;
+      wire                   do_read    = r_en & !empty;
+      wire [$clog2(DEPTH):0] count_next = count + {{$clog2(DEPTH){1'b0}}, do_write} - {{$clog2(DEPTH){1'b0}}, do_read};
+      reg                    almost_full_q, almost_empty_q;
+
+      always @(posedge clk) begin
+        if (rst_n) begin
+          almost_full_q  <= ALMOST_FULL_FREE >= CAPACITY;
+          almost_empty_q <= 1'b1;
+        end else begin
+          almost_full_q  <= count_next >= CAPACITY - ALMOST_FULL_FREE;
+          almost_empty_q <= count_next <= ALMOST_EMPTY;
+        end
+      end
+
+      assign almost_full  = almost_full_q;
+      assign almost_empty = almost_empty_q;
+    end else begin: combinational_flags
+      assign almost_full  = count >= CAPACITY - ALMOST_FULL_FREE;
+      assign almost_empty = count <= ALMOST_EMPTY;
+    end
+  endgenerate
+
   // Set Default values on reset.
   always@(posedge clk) begin
     if(rst_n) begin
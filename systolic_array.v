@@ -6,24 +6,49 @@ module systolic_array #(
     parameter MULT_LAT          = 3,                 // Multiplication latency
     parameter ACC_LAT           = 1,                 // Addition latency (<=1, not support pipelined acc)
     parameter ROWS              = 4,                 // Row number of systolic array
-    parameter K                 = 4,
-    parameter COLS              = 4                  // Column number of systolic array
+    parameter K                 = 4,                 // Shortest job K; sizes the result queues, jobs set their own K by the sideband
+    parameter COLS              = 4,                 // Column number of systolic array
+    parameter MAC_FIFO_DEPTH    = 2,                 // Finished psums buffered per MAC (power of 2, 2 = ping-pong)
+    parameter IN_FIFO_DEPTH     = 8,                 // Beats buffered per input stream (power of 2 to use them all)
+    parameter OUT_FIFO_DEPTH    = 0,                 // Results buffered per output lane, 0: twice the drain pipeline
+    parameter CREDIT_FLOW       = 0,                 // If 1, input fifos fill up and return credits, output fifos stall at their slack
+    parameter DRAIN_LANES       = 1,                 // Output lanes per row, each drains COLS/DRAIN_LANES columns
+    parameter REGISTERED_STALL  = 0,                 // If 1, stall reaches the array through registers instead of one global net
+    parameter PACK              = 1,                 // Packed lanes per element: 1, 2 (dual-INT4) or 4 (quad-INT2), see mac
+    parameter INPUT_SKEW        = 0,                 // If 1, row/col data arrive dense and are skewed at the array edges
+    parameter RESULT_CAPTURE    = 1,                 // If 1, MACs capture finished psums instead of delaying them, see mac
+    parameter PERF_COUNTERS     = 0,                 // If 1, count utilization into the perf_* outputs
+    parameter PERF_WIDTH        = 64                 // Width of each perf counter
 )(
     input                       clk,
     input                       rst,
     input                       en,
-    input                       flush,               // If 1, flush the pipeline
-    input                       rst_accumulator_rdy, // If 1, reset accumulator in array
-    input                       stream_out_rdy,      // If 1, stream acc result out
-    input [IN_WIDTH*ROWS-1:0]   row_data_in,         // AXIS row_data_in
+    input                       flush,               // If 1, no more input: keep the pipeline moving while the input fifos are empty
+    input                       rst_accumulator_rdy, // If 1, reset accumulator in array: first beat of a job
+    input                       stream_out_rdy,      // If 1, stream acc result out: last beat of a job
+    input [IN_WIDTH*ROWS-1:0]   row_data_in,         // AXIS row_data_in, beat t row r is A[r][t-r], or A[r][t] with INPUT_SKEW
     input                       row_data_in_vld,
     output                      row_data_in_rdy,
-    input [IN_WIDTH*COLS-1:0]   col_data_in,         // AXIS col_data_in
+    output                      row_data_in_credit,  // CREDIT_FLOW: one pulse per row_data_in slot freed
+    input [IN_WIDTH*COLS-1:0]   col_data_in,         // AXIS col_data_in, beat t col c is B[t-c][c], or B[t][c] with INPUT_SKEW
     input                       col_data_in_vld,
     output                      col_data_in_rdy,
-    output [OUT_WIDTH*ROWS-1:0] row_data_out,        // AXIS row_data_out
+    output                      col_data_in_credit,  // CREDIT_FLOW: one pulse per col_data_in slot freed
+    output [OUT_WIDTH*ROWS*DRAIN_LANES-1:0] row_data_out, // AXIS row_data_out, lane l row r at OUT_WIDTH*(l*ROWS+r)
     output                      row_data_out_vld,
-    input                       row_data_out_rdy
+    input                       row_data_out_rdy,
+    // Performance counters, cleared by rst, all zero unless PERF_COUNTERS.
+    // Every cycle after reset lands in exactly one of active, out_stall,
+    // mac_stall, starve_a or starve_b, so they add up to perf_cycles. A
+    // stalled cycle is charged to the flags its stall was built from, 3
+    // cycles old with REGISTERED_STALL.
+    output [PERF_WIDTH-1:0]     perf_cycles,           // cycles since reset
+    output [PERF_WIDTH-1:0]     perf_active_cycles,    // both input beats read into the array
+    output [PERF_WIDTH-1:0]     perf_out_stall_cycles, // stalled by an output row fifo half full
+    output [PERF_WIDTH-1:0]     perf_mac_stall_cycles, // stalled by a MAC output fifo full only
+    output [PERF_WIDTH-1:0]     perf_starve_a_cycles,  // no output/MAC stall, row (A) input fifo empty
+    output [PERF_WIDTH-1:0]     perf_starve_b_cycles,  // no output/MAC stall, A not empty, col (B) input fifo empty
+    output [PERF_WIDTH-1:0]     perf_out_beats         // row_data_out beats accepted
 );
     
     // rst_accumulator wires 
@@ -36,6 +61,11 @@ module systolic_array #(
     wire            stream_out_rdy_out  [0:ROWS][0:COLS];
     wire [COLS-1:0] control_stream_out_rdy;
 
+    // capture wires
+    wire            capture_in          [0:ROWS][0:COLS];
+    wire            capture_out         [0:ROWS][0:COLS];
+    wire [COLS-1:0] control_capture;
+
     // row data for macs [column number][row number]
     // data starts from first column and propogates through columns
     // cannot use COLS-1 or ROWS-1 as for multiples of 4, will wrap around and overrite first value
@@ -51,7 +81,7 @@ module systolic_array #(
     // wires for bypass data [row number][column number]
     // only needed between rows and columns, last one not used
     // cannot use COLS-1 or ROWS-1 as for multiples of 4, will wrap around and overrite first value
-    wire  [IN_WIDTH-1:0] bypass_data_in      [0:ROWS][0:COLS];
+    wire [OUT_WIDTH-1:0] bypass_data_in      [0:ROWS][0:COLS];
     wire                 bypass_data_in_vld  [0:ROWS][0:COLS];
     wire [OUT_WIDTH-1:0] bypass_data_out     [0:ROWS][0:COLS];
     wire                 bypass_data_out_vld [0:ROWS][0:COLS];
@@ -73,9 +103,22 @@ module systolic_array #(
     // Apply the reduction OR operator to the flattened array
     assign flag_found = |flat_array;
 
-    // wires receiving bypass data
-    wire           [ROWS-1:0] row_data_out_tmp_vld;
-    wire [OUT_WIDTH*ROWS-1:0] row_data_out_tmp;
+    // Drain groups: columns [l*DRAIN_COLS, (l+1)*DRAIN_COLS) shift their results
+    // west to column l*DRAIN_COLS, which feeds output lane l of every row
+    localparam DRAIN_COLS = COLS / DRAIN_LANES;
+
+    generate
+        if (COLS % DRAIN_LANES != 0) begin: bad_drain_lanes
+            initial $fatal(1, "DRAIN_LANES (%0d) must divide COLS (%0d)", DRAIN_LANES, COLS);
+        end
+        if (IN_WIDTH % PACK != 0 || OUT_WIDTH % PACK != 0) begin: bad_pack
+            initial $fatal(1, "PACK (%0d) must divide IN_WIDTH (%0d) and OUT_WIDTH (%0d)", PACK, IN_WIDTH, OUT_WIDTH);
+        end
+    endgenerate
+
+    // wires receiving bypass data, one per row and lane
+    wire           [ROWS*DRAIN_LANES-1:0] row_data_out_tmp_vld;
+    wire [OUT_WIDTH*ROWS*DRAIN_LANES-1:0] row_data_out_tmp;
     
     // input fifo queue signals
     wire                      fifoin_a_full;
@@ -86,12 +129,15 @@ module systolic_array #(
     wire                      fifoin_b_empty;
     
     // output fifo queue signals
-    wire                      fifoout_empty [0:ROWS];
-    wire                      fifoout_full  [0:ROWS];
-    wire                      fifoout_half_full  [0:ROWS];
-    wire [OUT_WIDTH-1:0]      fifoout_out  [0:ROWS];
-    wire                      fifoout_half_full_any;
-    wire  [ROWS-1:0]          fifoout_half_full_tmp;
+    wire                      fifoout_empty [0:ROWS][0:DRAIN_LANES];
+    wire                      fifoout_full  [0:ROWS][0:DRAIN_LANES];
+    wire                      fifoout_half_full  [0:ROWS][0:DRAIN_LANES];
+    wire                      fifoout_almost_full [0:ROWS][0:DRAIN_LANES];
+    wire [OUT_WIDTH-1:0]      fifoout_out  [0:ROWS][0:DRAIN_LANES];
+    // an output fifo down to the slack for the results still in flight
+    wire                      fifoout_stall_any;
+    wire  [ROWS*DRAIN_LANES-1:0] fifoout_stall_tmp;
+    wire  [ROWS*DRAIN_LANES-1:0] fifoout_stall_by_row;
 
     // input signals from input fifo queues
     wire [ROWS*IN_WIDTH-1:0] row_data_in_reg;
@@ -101,53 +147,269 @@ module systolic_array #(
     wire                     rst_accumulator_rdy_reg;
     wire                     stream_out_rdy_reg;
     
+    // Cycles from a stall condition to the stall it causes: 0 when combinational,
+    // 3 register stages when REGISTERED_STALL (per-row reduction, global OR,
+    // per-row and per-column copies). Every fifo that keeps filling during
+    // that window gets STALL_DELAY spare slots and flags early by the same
+    // amount.
+    localparam STALL_DELAY = REGISTERED_STALL ? 3 : 0;
+
+    // Results that may still reach an output fifo once it asks for a stall
+    localparam OUT_SLACK      = MULT_LAT+ACC_LAT+(COLS*ROWS/K)+STALL_DELAY;
+    // By default half full, still able to flush remaining stages and hold results
+    localparam OUT_FIFO_SLOTS = OUT_FIFO_DEPTH != 0 ? OUT_FIFO_DEPTH : 2*OUT_SLACK;
+
+    generate
+        if (IN_FIFO_DEPTH < 2) begin: bad_in_fifo_depth
+            initial $fatal(1, "IN_FIFO_DEPTH (%0d) must be at least 2", IN_FIFO_DEPTH);
+        end
+        // The stall must leave room for every result still in flight
+        if (CREDIT_FLOW ? (1 << $clog2(OUT_FIFO_SLOTS)) <= OUT_SLACK
+                        : (1 << $clog2(OUT_FIFO_SLOTS)) / 2 < OUT_SLACK) begin: bad_out_fifo_depth
+            initial $fatal(1, "OUT_FIFO_DEPTH (%0d) too small for %0d results in flight", OUT_FIFO_SLOTS, OUT_SLACK);
+        end
+    endgenerate
+
+    wire fifoin_a_almost_empty;
+    wire fifoin_b_almost_empty;
+
     // Sync row and col and consider output fifo slots which is related to row_data_out_rdy
     wire inputs_all_valid = !fifoin_a_empty && !fifoin_b_empty && row_data_in_vld_reg && col_data_in_vld_reg && !stall;
     
-    // Input queue (deal with vld signals)
+    // Input queue (deal with vld signals). Without CREDIT_FLOW a beat is
+    // only taken below half full; with it the sender tracks the free slots
+    // and every slot can be filled.
+    wire fifoin_a_accept = CREDIT_FLOW ? !fifoin_a_full : !fifoin_a_half_full;
+    wire fifoin_b_accept = CREDIT_FLOW ? !fifoin_b_full : !fifoin_b_half_full;
+
     synchronous_fifo #(
-        .DEPTH(8),
-        .DATA_WIDTH(IN_WIDTH*ROWS + 3)
+        .DEPTH(IN_FIFO_DEPTH + 2*STALL_DELAY),
+        .DATA_WIDTH(IN_WIDTH*ROWS + 3),
+        .ALMOST_EMPTY(STALL_DELAY),
+        .REGISTERED_FLAGS(CREDIT_FLOW)
     ) input_a_fifo (
         .clk(clk),
         .rst_n(rst),
-        .w_en(row_data_in_vld && !fifoin_a_half_full),
+        .w_en(row_data_in_vld && fifoin_a_accept),
         .r_en(inputs_all_valid),
         .data_in({stream_out_rdy, rst_accumulator_rdy, row_data_in_vld, row_data_in}),
         .data_out({stream_out_rdy_reg, rst_accumulator_rdy_reg, row_data_in_vld_reg, row_data_in_reg}),
         .full(fifoin_a_full),
         .half_full(fifoin_a_half_full),
-        .empty(fifoin_a_empty)
+        .empty(fifoin_a_empty),
+        .almost_full(),
+        .almost_empty(fifoin_a_almost_empty)
     );
 
     // Input queue (deal with vld signals)
     synchronous_fifo #(
-        .DEPTH(8),
-        .DATA_WIDTH(IN_WIDTH*COLS + 1)
+        .DEPTH(IN_FIFO_DEPTH + 2*STALL_DELAY),
+        .DATA_WIDTH(IN_WIDTH*COLS + 1),
+        .ALMOST_EMPTY(STALL_DELAY),
+        .REGISTERED_FLAGS(CREDIT_FLOW)
     ) input_b_fifo (
         .clk(clk),
         .rst_n(rst),
-        .w_en(col_data_in_vld && !fifoin_b_half_full),
+        .w_en(col_data_in_vld && fifoin_b_accept),
         .r_en(inputs_all_valid),
         .data_in({col_data_in_vld, col_data_in}),
         .data_out({col_data_in_vld_reg, col_data_in_reg}),
         .full(fifoin_b_full),
         .half_full(fifoin_b_half_full),
-        .empty(fifoin_b_empty)
+        .empty(fifoin_b_empty),
+        .almost_full(),
+        .almost_empty(fifoin_b_almost_empty)
     );
 
     
 
     assign row_data_out_vld = &(row_data_out_tmp_vld);
     assign row_data_out     = row_data_out_tmp;
-    assign fifoout_half_full_any = |(fifoout_half_full_tmp);
+    assign fifoout_stall_any = |(fifoout_stall_tmp);
+
+    assign row_data_in_rdy = fifoin_a_accept;
+    assign col_data_in_rdy = fifoin_b_accept;
 
-    assign row_data_in_rdy = !fifoin_a_half_full;
-    assign col_data_in_rdy = !fifoin_b_half_full;
+    // Both input fifos are read together, so each read frees one slot on
+    // either stream. The credit is a flop loaded by the read, high in the
+    // cycle after it. A sender starting with IN_FIFO_DEPTH credits never
+    // overruns a fifo, whatever the latency of the credit return path.
+    generate
+        if (CREDIT_FLOW) begin: credits
+            reg credit_q;
+            always @(posedge clk) begin
+                if (rst) begin
+                    credit_q <= 0;
+                end else begin
+                    credit_q <= inputs_all_valid;
+                end
+            end
+            assign row_data_in_credit = credit_q;
+            assign col_data_in_credit = credit_q;
+        end else begin: no_credits
+            assign row_data_in_credit = 0;
+            assign col_data_in_credit = 0;
+        end
+    endgenerate
     
-    // TODO: need to deal with high fanout
-    wire stall          = !flush && (fifoout_half_full_any || flag_found);
-    wire mac_read_stall = !flush && fifoout_half_full_any;
+    // Both input fifos must supply a beat for the array to advance: shifting
+    // while one is empty would feed zeros into the skewed stream, so a gap in
+    // either valid stalls the array until flush marks the end of the input.
+    // With a delayed stall the fifos must still hold a beat for every cycle
+    // of the delay, hence almost_empty (= empty when STALL_DELAY is 0).
+    wire input_starved = fifoin_a_almost_empty || fifoin_b_almost_empty;
+
+    // stall drives the input fifo reads (through inputs_all_valid), the
+    // credit flop and the perf counters; mac_read_stall only the latter.
+    // row_stall/row_read_stall drive the MACs and output fifos of each row
+    // and lane r of the west skew, col_stall the north skew and ctrl, one
+    // copy per column. All of them carry the same value in the same cycle.
+    // public so the test bench can trigger tracing on it
+    wire            stall /*verilator public_flat_rd*/;
+    wire            mac_read_stall;
+    wire [ROWS-1:0] row_stall;
+    wire [ROWS-1:0] row_read_stall;
+    wire [COLS-1:0] col_stall;
+    // The flags the stall of this cycle was built from, for the perf counters
+    wire            stall_by_out;
+    wire            stall_by_mac;
+    wire            stall_by_starve_a;
+
+    generate
+        if (REGISTERED_STALL) begin: registered_stall
+            // stage 1: per-row reductions, stage 2: global OR, stage 3: per-row
+            // and per-column copies, plus one for the edge logic
+            reg  [ROWS-1:0] row_mac_full_q;
+            reg  [ROWS-1:0] row_out_half_q;
+            reg             starve_q;
+            reg             stall_q;
+            reg             read_stall_q;
+            reg  [ROWS-1:0] row_stall_q;
+            reg  [ROWS-1:0] row_read_stall_q;
+            reg  [COLS-1:0] col_stall_q;
+            reg             edge_stall_q;
+            reg             edge_read_stall_q;
+            // the same stages for the counters: what the stall came from
+            reg             starve_a_q;
+            reg             mac_full_q;
+            reg             starve_a_qq;
+            reg             edge_mac_full_q;
+            reg             edge_starve_a_q;
+
+            genvar r;
+            for (r = 0; r < ROWS; r = r + 1) begin: rows
+                always @(posedge clk) begin
+                    if (rst) begin
+                        row_mac_full_q[r]   <= 0;
+                        row_out_half_q[r]   <= 0;
+                        row_stall_q[r]      <= 0;
+                        row_read_stall_q[r] <= 0;
+                    end else begin
+                        row_mac_full_q[r]   <= |flat_array[r*COLS +: COLS];
+                        row_out_half_q[r]   <= |fifoout_stall_by_row[r*DRAIN_LANES +: DRAIN_LANES];
+                        row_stall_q[r]      <= stall_q;
+                        row_read_stall_q[r] <= read_stall_q;
+                    end
+                end
+            end
+
+            genvar c;
+            for (c = 0; c < COLS; c = c + 1) begin: cols
+                always @(posedge clk) begin
+                    if (rst) begin
+                        col_stall_q[c] <= 0;
+                    end else begin
+                        col_stall_q[c] <= stall_q;
+                    end
+                end
+            end
+
+            always @(posedge clk) begin
+                if (rst) begin
+                    starve_q          <= 0;
+                    stall_q           <= 0;
+                    read_stall_q      <= 0;
+                    edge_stall_q      <= 0;
+                    edge_read_stall_q <= 0;
+                    starve_a_q        <= 0;
+                    mac_full_q        <= 0;
+                    starve_a_qq       <= 0;
+                    edge_mac_full_q   <= 0;
+                    edge_starve_a_q   <= 0;
+                end else begin
+                    starve_q          <= !flush && input_starved;
+                    stall_q           <= |row_mac_full_q || |row_out_half_q || starve_q;
+                    read_stall_q      <= |row_out_half_q;
+                    edge_stall_q      <= stall_q;
+                    edge_read_stall_q <= read_stall_q;
+                    starve_a_q        <= !flush && fifoin_a_almost_empty;
+                    mac_full_q        <= |row_mac_full_q;
+                    starve_a_qq       <= starve_a_q;
+                    edge_mac_full_q   <= mac_full_q;
+                    edge_starve_a_q   <= starve_a_qq;
+                end
+            end
+
+            assign stall          = edge_stall_q;
+            assign mac_read_stall = edge_read_stall_q;
+            assign row_stall      = row_stall_q;
+            assign row_read_stall = row_read_stall_q;
+            assign col_stall      = col_stall_q;
+
+            assign stall_by_out      = edge_read_stall_q;
+            assign stall_by_mac      = edge_mac_full_q;
+            assign stall_by_starve_a = edge_starve_a_q;
+        end else begin: combinational_stall
+            assign stall          = fifoout_stall_any || flag_found || (!flush && input_starved);
+            assign mac_read_stall = fifoout_stall_any;
+            assign row_stall      = {ROWS{stall}};
+            assign row_read_stall = {ROWS{mac_read_stall}};
+            assign col_stall      = {COLS{stall}};
+
+            assign stall_by_out      = fifoout_stall_any;
+            assign stall_by_mac      = flag_found;
+            assign stall_by_starve_a = fifoin_a_almost_empty;
+        end
+    endgenerate
+
+    // Edge data of the array: the beat read from the input fifos, or zeros
+    // while the array steps without input. With INPUT_SKEW the staircase
+    // the array needs (row r and column c r and c steps late) is built
+    // here by delay lines that shift with the array, so the host sends
+    // plain A columns and B rows without the skew padding.
+    wire [IN_WIDTH*ROWS-1:0] row_edge_in = inputs_all_valid ? row_data_in_reg : '0;
+    wire [IN_WIDTH*COLS-1:0] col_edge_in = inputs_all_valid ? col_data_in_reg : '0;
+    wire [IN_WIDTH*ROWS-1:0] row_edge;
+    wire [IN_WIDTH*COLS-1:0] col_edge;
+
+    generate
+        if (INPUT_SKEW) begin: input_skew
+            skew #(
+                .LANES(ROWS),
+                .WIDTH(IN_WIDTH)
+            ) skew_west (
+                .clk(clk),
+                .rst(rst),
+                .en(~row_stall),
+                .data_in(row_edge_in),
+                .data_out(row_edge)
+            );
+
+            skew #(
+                .LANES(COLS),
+                .WIDTH(IN_WIDTH)
+            ) skew_north (
+                .clk(clk),
+                .rst(rst),
+                .en(~col_stall),
+                .data_in(col_edge_in),
+                .data_out(col_edge)
+            );
+        end else begin: host_skew
+            assign row_edge = row_edge_in;
+            assign col_edge = col_edge_in;
+        end
+    endgenerate
 
     generate
         genvar row, col;
@@ -156,21 +418,29 @@ module systolic_array #(
         for (row = 0; row < ROWS; row = row + 1) begin: assign_col_data_in
             for (col = 0; col < COLS; col = col + 1) begin: assign_col_data_in
                 if (row == 0) begin
-                    assign mac_col_data_in[0][col]     = (inputs_all_valid) ? col_data_in_reg[IN_WIDTH*col +: IN_WIDTH] : 0;
+                    assign mac_col_data_in[0][col]     = col_edge[IN_WIDTH*col +: IN_WIDTH];
                     assign rst_accumulator_in[0][col]  = control_rst_accumulator_rdy[col];
                     assign stream_out_rdy_in[0][col]   = control_stream_out_rdy[col];
+                    assign capture_in[0][col]          = control_capture[col];
                 end else begin
                     assign mac_col_data_in[row][col]     = mac_col_data_out[row-1][col];
                     assign rst_accumulator_in[row][col]  = rst_accumulator_out[row-1][col];
                     assign stream_out_rdy_in[row][col]   = stream_out_rdy_out[row-1][col];
+                    assign capture_in[row][col]          = capture_out[row-1][col];
                 end
                 if (col == 0) begin
-                    assign mac_row_data_in[0][row] = (inputs_all_valid) ? row_data_in_reg[IN_WIDTH*row +: IN_WIDTH] : 0;
+                    assign mac_row_data_in[0][row] = row_edge[IN_WIDTH*row +: IN_WIDTH];
                 end else begin
                     assign mac_row_data_in[col][row] = mac_row_data_out[col-1][row];
                 end
-                assign bypass_data_in[row][col]     = bypass_data_out[row][col+1];
-                assign bypass_data_in_vld[row][col] = bypass_data_out_vld[row][col+1];
+                // the last column of a drain group does not take results from the next group
+                if ((col + 1) % DRAIN_COLS == 0) begin
+                    assign bypass_data_in[row][col]     = 0;
+                    assign bypass_data_in_vld[row][col] = 0;
+                end else begin
+                    assign bypass_data_in[row][col]     = bypass_data_out[row][col+1];
+                    assign bypass_data_in_vld[row][col] = bypass_data_out_vld[row][col+1];
+                end
             end
           //  assign row_data_out_tmp[OUT_WIDTH*row +: OUT_WIDTH] = bypass_data_out[row][0];
           //  assign row_data_out_tmp_vld[row] = bypass_data_out_vld[row][0];
@@ -179,6 +449,12 @@ module systolic_array #(
         // instantiate MAC array
         for (row = 0; row < ROWS; row = row + 1) begin: instantiate_mac_rows
             for (col = 0; col < COLS; col = col + 1) begin: instantiate_mac_cols
+                // Steps from this column finishing a sum to its release with
+                // the last column, and the later tiles finishing meanwhile;
+                // jobs of K or more steps each, so at most HOLD of them
+                localparam RELEASE_WAIT = COLS - 1 - col;
+                localparam HOLD         = (RELEASE_WAIT + K - 1) / K;
+
                 mac #(
                     .IN_WIDTH(IN_WIDTH),
                     .IN_FRAC(IN_FRAC),
@@ -191,20 +467,27 @@ module systolic_array #(
                     .ROWS(ROWS),
                     .COLS_IDX(col),
                     .ROWS_IDX(row),
-                    .FIFO_DEPTH(2)
+                    .FIFO_DEPTH(MAC_FIFO_DEPTH),
+                    .DRAIN_COLS(DRAIN_COLS),
+                    .SKID(STALL_DELAY),
+                    .PACK(PACK),
+                    .RESULT_CAPTURE(RESULT_CAPTURE),
+                    .HOLD(HOLD)
                 ) mac (
                     .clk(clk),
                     .rst(rst),
-                    .stall(stall),
-                    .mac_read_stall(mac_read_stall),
+                    .stall(row_stall[row]),
+                    .mac_read_stall(row_read_stall[row]),
                     .rst_accumulator_in(rst_accumulator_in[row][col]),
                     .stream_out_rdy_in(stream_out_rdy_in[row][col]),
+                    .capture_in(capture_in[row][col]),
                     .row_data_in(mac_row_data_in[col][row]),
                     .col_data_in(mac_col_data_in[row][col]),
                     .bypass_data_in(bypass_data_in[row][col]),
                     .bypass_data_in_vld(bypass_data_in_vld[row][col]),
                     .rst_accumulator_out(rst_accumulator_out[row][col]),
                     .stream_out_rdy_out(stream_out_rdy_out[row][col]),
+                    .capture_out(capture_out[row][col]),
                     .row_data_out(mac_row_data_out[col][row]),
                     .col_data_out(mac_col_data_out[row][col]),
                     .psum_out(bypass_data_out[row][col]),
@@ -214,25 +497,34 @@ module systolic_array #(
             end
         end
 
+        genvar lane;
         for (row = 0; row < ROWS; row = row + 1) begin: data_out
-            synchronous_fifo #(
-                // if half full, still able to flush remaining stages and hold results
-                    .DEPTH(2*(MULT_LAT+ACC_LAT+(COLS*ROWS/K))), // double the pipeline depth
-                    .DATA_WIDTH(OUT_WIDTH)
-                ) output_row_fifo (
-                    .clk(clk),
-                    .rst_n(rst),
-                    .w_en(bypass_data_out_vld[row][0] && !fifoout_full[row] && !mac_read_stall),
-                    .r_en(row_data_out_rdy && !fifoout_empty[row] && &(row_data_out_tmp_vld)),
-                    .data_in(bypass_data_out[row][0]),
-                    .data_out(fifoout_out[row]),
-                    .full(fifoout_full[row]),
-                    .half_full(fifoout_half_full[row]),
-                    .empty(fifoout_empty[row])
-                );
-            assign row_data_out_tmp[OUT_WIDTH*row +: OUT_WIDTH] = fifoout_out[row];
-            assign row_data_out_tmp_vld[row] = !fifoout_empty[row];
-            assign fifoout_half_full_tmp[row] = fifoout_half_full[row];
+            for (lane = 0; lane < DRAIN_LANES; lane = lane + 1) begin: lanes
+                synchronous_fifo #(
+                        .DEPTH(OUT_FIFO_SLOTS), // double the pipeline depth by default, for the shortest jobs
+                        .DATA_WIDTH(OUT_WIDTH),
+                        .ALMOST_FULL_FREE(OUT_SLACK),
+                        .REGISTERED_FLAGS(CREDIT_FLOW)
+                    ) output_row_fifo (
+                        .clk(clk),
+                        .rst_n(rst),
+                        .w_en(bypass_data_out_vld[row][lane*DRAIN_COLS] && !fifoout_full[row][lane] && !row_read_stall[row]),
+                        .r_en(row_data_out_rdy && !fifoout_empty[row][lane] && &(row_data_out_tmp_vld)),
+                        .data_in(bypass_data_out[row][lane*DRAIN_COLS]),
+                        .data_out(fifoout_out[row][lane]),
+                        .full(fifoout_full[row][lane]),
+                        .half_full(fifoout_half_full[row][lane]),
+                        .empty(fifoout_empty[row][lane]),
+                        .almost_full(fifoout_almost_full[row][lane]),
+                        .almost_empty()
+                    );
+                assign row_data_out_tmp[OUT_WIDTH*(lane*ROWS+row) +: OUT_WIDTH] = fifoout_out[row][lane];
+                assign row_data_out_tmp_vld[lane*ROWS+row] = !fifoout_empty[row][lane];
+                // Half full keeps at least OUT_SLACK slots only at the default depth;
+                // with CREDIT_FLOW the fifo fills up to exactly OUT_SLACK free slots
+                assign fifoout_stall_tmp[lane*ROWS+row] = CREDIT_FLOW ? fifoout_almost_full[row][lane] : fifoout_half_full[row][lane];
+                assign fifoout_stall_by_row[row*DRAIN_LANES+lane] = fifoout_stall_tmp[lane*ROWS+row];
+            end
         end
     endgenerate
 
@@ -250,14 +542,68 @@ module systolic_array #(
     ) ctrl_0(
         .clk(clk),
         .rst(rst),
-        .stall(stall),
+        .stall(col_stall),
         .input_rst_accumulator(rst_accumulator_rdy_reg && inputs_all_valid),
         .input_stream_out_rdy(stream_out_rdy_reg && inputs_all_valid),
         .rst_accumulator(control_rst_accumulator_rdy),
-        .stream_out_rdy(control_stream_out_rdy)
+        .stream_out_rdy(control_stream_out_rdy),
+        .capture(control_capture)
     );
 
 
+    // Performance counters
+    generate
+        if (PERF_COUNTERS) begin: perf
+            reg [PERF_WIDTH-1:0] cycles, active, out_stall, mac_stall, starve_a, starve_b, out_beats;
+
+            always @(posedge clk) begin
+                if (rst) begin
+                    cycles    <= 0;
+                    active    <= 0;
+                    out_stall <= 0;
+                    mac_stall <= 0;
+                    starve_a  <= 0;
+                    starve_b  <= 0;
+                    out_beats <= 0;
+                end else begin
+                    cycles <= cycles + 1;
+                    // a cycle that moves data is active; a stalled one goes to the
+                    // flags its stall was built from, output pressure first, then
+                    // MAC pressure, then starvation; an unstalled one without a
+                    // read waits on an empty input fifo
+                    if (inputs_all_valid) begin
+                        active    <= active + 1;
+                    end else if (stall && stall_by_out) begin
+                        out_stall <= out_stall + 1;
+                    end else if (stall && stall_by_mac) begin
+                        mac_stall <= mac_stall + 1;
+                    end else if (stall ? stall_by_starve_a : fifoin_a_empty) begin
+                        starve_a <= starve_a + 1;
+                    end else begin
+                        starve_b <= starve_b + 1;
+                    end
+                    if (row_data_out_vld && row_data_out_rdy) out_beats <= out_beats + 1;
+                end
+            end
+
+            assign perf_cycles           = cycles;
+            assign perf_active_cycles    = active;
+            assign perf_out_stall_cycles = out_stall;
+            assign perf_mac_stall_cycles = mac_stall;
+            assign perf_starve_a_cycles  = starve_a;
+            assign perf_starve_b_cycles  = starve_b;
+            assign perf_out_beats        = out_beats;
+        end else begin: no_perf
+            assign perf_cycles           = 0;
+            assign perf_active_cycles    = 0;
+            assign perf_out_stall_cycles = 0;
+            assign perf_mac_stall_cycles = 0;
+            assign perf_starve_a_cycles  = 0;
+            assign perf_starve_b_cycles  = 0;
+            assign perf_out_beats        = 0;
+        end
+    endgenerate
+
     // // Debug
     // always @(posedge clk) begin
     //     $display("----------------------------");
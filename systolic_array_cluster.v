@@ -0,0 +1,154 @@
+module systolic_array_cluster #(
+    parameter IN_WIDTH          = 8,
+    parameter IN_FRAC           = 0,
+    parameter OUT_WIDTH         = 8,
+    parameter OUT_FRAC          = 0,
+    parameter MULT_LAT          = 3,                 // Multiplication latency
+    parameter ACC_LAT           = 1,                 // Addition latency (<=1, not support pipelined acc)
+    parameter ROWS              = 4,                 // Row number of each array
+    parameter K                 = 4,                 // Shortest job K, see systolic_array
+    parameter COLS              = 4,                 // Column number of each array
+    parameter MAC_FIFO_DEPTH    = 2,                 // Finished psums buffered per MAC, see systolic_array
+    parameter DRAIN_LANES       = 1,                 // Output lanes per row of each array, see systolic_array
+    parameter INPUT_SKEW        = 0,                 // If 1, row/col data arrive dense, see systolic_array
+    parameter RESULT_CAPTURE    = 1,                 // see systolic_array
+    parameter ARRAYS            = 2,                 // Number of systolic_array instances
+    parameter SHARED_B          = 0                  // If 1, one col_data_in stream is broadcast to every array
+)(
+    input                                   clk,
+    input                                   rst,
+    input                                   en,
+    input  [ARRAYS-1:0]                     flush,               // per array, see systolic_array
+    input  [ARRAYS-1:0]                     rst_accumulator_rdy, // sideband of each array's row_data_in beat
+    input  [ARRAYS-1:0]                     stream_out_rdy,      // sideband of each array's row_data_in beat
+    input  [IN_WIDTH*ROWS*ARRAYS-1:0]       row_data_in,         // AXIS row_data_in of array a at IN_WIDTH*ROWS*a
+    input  [ARRAYS-1:0]                     row_data_in_vld,
+    output [ARRAYS-1:0]                     row_data_in_rdy,
+    input  [IN_WIDTH*COLS*(SHARED_B ? 1 : ARRAYS)-1:0] col_data_in, // AXIS col_data_in of array a at IN_WIDTH*COLS*a, or one for all
+    input  [(SHARED_B ? 1 : ARRAYS)-1:0]    col_data_in_vld,
+    output [(SHARED_B ? 1 : ARRAYS)-1:0]    col_data_in_rdy,
+    output [OUT_WIDTH*ROWS*DRAIN_LANES-1:0] row_data_out,        // AXIS row_data_out of the array in row_data_out_array
+    output [(ARRAYS > 1 ? $clog2(ARRAYS) : 1)-1:0] row_data_out_array,
+    output                                  row_data_out_vld,
+    input                                   row_data_out_rdy
+);
+
+    // ARRAYS independent arrays behind one set of ports. Every array has
+    // its own A stream; B is either distributed (one stream per array) or,
+    // with SHARED_B, broadcast: a beat is taken only when every array can
+    // take it, so all arrays see the same B tiles in the same order and the
+    // host sends each B tile once per group of ARRAYS A tiles. The output
+    // streams are merged round-robin into one, each beat tagged with the
+    // array it came from; per array the beats keep their order.
+    localparam OUT_BITS = OUT_WIDTH*ROWS*DRAIN_LANES;
+    localparam ID_WIDTH = ARRAYS > 1 ? $clog2(ARRAYS) : 1;
+
+    wire [OUT_BITS-1:0] array_data_out [0:ARRAYS-1];
+    wire [ARRAYS-1:0]   array_data_out_vld;
+    wire [ARRAYS-1:0]   array_data_out_rdy;
+    wire [ARRAYS-1:0]   array_col_data_in_rdy;
+
+    genvar a;
+    generate
+        for (a = 0; a < ARRAYS; a = a + 1) begin: arrays
+            wire [IN_WIDTH*COLS-1:0] col_in;
+            wire                     col_in_vld;
+
+            if (SHARED_B) begin: shared_b
+                assign col_in     = col_data_in;
+                assign col_in_vld = col_data_in_vld[0] && col_data_in_rdy[0];
+            end else begin: own_b
+                assign col_in     = col_data_in[IN_WIDTH*COLS*a +: IN_WIDTH*COLS];
+                assign col_in_vld = col_data_in_vld[a];
+                assign col_data_in_rdy[a] = array_col_data_in_rdy[a];
+            end
+
+            systolic_array #(
+                .IN_WIDTH(IN_WIDTH),
+                .IN_FRAC(IN_FRAC),
+                .OUT_WIDTH(OUT_WIDTH),
+                .OUT_FRAC(OUT_FRAC),
+                .MULT_LAT(MULT_LAT),
+                .ACC_LAT(ACC_LAT),
+                .ROWS(ROWS),
+                .K(K),
+                .COLS(COLS),
+                .MAC_FIFO_DEPTH(MAC_FIFO_DEPTH),
+                .DRAIN_LANES(DRAIN_LANES),
+                .INPUT_SKEW(INPUT_SKEW),
+                .RESULT_CAPTURE(RESULT_CAPTURE)
+            ) array (
+                .clk(clk),
+                .rst(rst),
+                .en(en),
+                .flush(flush[a]),
+                .rst_accumulator_rdy(rst_accumulator_rdy[a]),
+                .stream_out_rdy(stream_out_rdy[a]),
+                .row_data_in(row_data_in[IN_WIDTH*ROWS*a +: IN_WIDTH*ROWS]),
+                .row_data_in_vld(row_data_in_vld[a]),
+                .row_data_in_rdy(row_data_in_rdy[a]),
+                .row_data_in_credit(),
+                .col_data_in(col_in),
+                .col_data_in_vld(col_in_vld),
+                .col_data_in_rdy(array_col_data_in_rdy[a]),
+                .col_data_in_credit(),
+                .row_data_out(array_data_out[a]),
+                .row_data_out_vld(array_data_out_vld[a]),
+                .row_data_out_rdy(array_data_out_rdy[a]),
+                .perf_cycles(),
+                .perf_active_cycles(),
+                .perf_out_stall_cycles(),
+                .perf_mac_stall_cycles(),
+                .perf_starve_a_cycles(),
+                .perf_starve_b_cycles(),
+                .perf_out_beats()
+            );
+        end
+
+        if (SHARED_B) begin: broadcast_rdy
+            // array rdy is registered (input fifo not half full), so this does not depend on vld
+            assign col_data_in_rdy = &array_col_data_in_rdy;
+        end
+    endgenerate
+
+    // Round-robin merge: the valid array closest at or after `next` wins
+    reg  [31:0]         next;
+    reg  [31:0]         grant;
+    reg  [31:0]         distance;
+    reg  [31:0]         best;
+    reg                 grant_vld;
+    integer i;
+
+    always @(*) begin
+        grant     = next;
+        best      = ARRAYS;
+        grant_vld = 0;
+        for (i = 0; i < ARRAYS; i = i + 1) begin
+            distance = (i + ARRAYS - next) % ARRAYS;
+            if (array_data_out_vld[i] && distance < best) begin
+                grant     = i;
+                best      = distance;
+                grant_vld = 1;
+            end
+        end
+    end
+
+    always @(posedge clk) begin
+        if (rst) begin
+            next <= 0;
+        end else if (grant_vld && row_data_out_rdy) begin
+            next <= (grant == ARRAYS - 1) ? 0 : grant + 1;
+        end
+    end
+
+    generate
+        for (a = 0; a < ARRAYS; a = a + 1) begin: merge
+            assign array_data_out_rdy[a] = grant_vld && (grant == a) && row_data_out_rdy;
+        end
+    endgenerate
+
+    assign row_data_out       = array_data_out[grant[ID_WIDTH-1:0]];
+    assign row_data_out_array = grant[ID_WIDTH-1:0];
+    assign row_data_out_vld   = grant_vld;
+
+endmodule
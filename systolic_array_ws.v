@@ -0,0 +1,236 @@
+module systolic_array_ws #(
+    parameter IN_WIDTH          = 8,
+    parameter IN_FRAC           = 0,
+    parameter OUT_WIDTH         = 8,
+    parameter OUT_FRAC          = 0,
+    parameter MULT_LAT          = 3,                 // Multiplication latency
+    parameter ACC_LAT           = 1,                 // Addition latency (<=1, not support pipelined acc)
+    parameter K                 = 4,                 // Row number of the array, the reduction dimension
+    parameter COLS              = 4                  // Column number of the array
+)(
+    input                       clk,
+    input                       rst,
+    input [IN_WIDTH*K-1:0]      row_data_in,         // AXIS row_data_in, one dense row of A per beat
+    input                       swap_weights_rdy,    // If 1, this A row and the ones after it use the newly loaded B
+    input                       row_data_in_vld,
+    output                      row_data_in_rdy,
+    input [IN_WIDTH*COLS-1:0]   col_data_in,         // AXIS col_data_in, one row of B per beat, row 0 first
+    input                       col_data_in_vld,
+    output                      col_data_in_rdy,
+    output [OUT_WIDTH*COLS-1:0] row_data_out,        // AXIS row_data_out, one row of C per beat
+    output                      row_data_out_vld,
+    input                       row_data_out_rdy
+);
+
+    // Weight-stationary dataflow: PE (k, c) holds B[k][c]. B is loaded once
+    // per tile, K beats shifting up the columns into the shadow weights,
+    // while the previous tile computes. A rows then stream east, skewed one
+    // cycle per row inside the array, and the partial sums of C flow south,
+    // leaving the bottom row skewed one cycle per column to be lined up
+    // again before the output fifo. The pipeline never stalls: an A row is
+    // only issued once its result is sure to find a slot in the output
+    // fifo, and cycles without an issue are bubbles.
+
+    // Issue to the deskewed result: K rows and COLS columns of travel, the
+    // multiplier, and the adder's register
+    localparam MULT_STAGES  = MULT_LAT < 1 ? 1 : MULT_LAT;
+    localparam PIPE         = K + COLS - 1 + MULT_STAGES;
+    localparam OUT_DEPTH    = 2 * (PIPE + 1);
+    localparam OUT_CAPACITY = 1 << $clog2(OUT_DEPTH);
+    // Cycles from a swap until it has passed the last PE and the shadow
+    // weights may be overwritten
+    localparam SWAP_BUSY    = K + COLS - 1;
+
+    // data for macs [row number][column number]
+    wire [IN_WIDTH-1:0]  mac_row_data_in   [0:K][0:COLS];
+    wire                 mac_swap_in       [0:K][0:COLS];
+    wire [IN_WIDTH-1:0]  mac_row_data_out  [0:K][0:COLS];
+    wire                 mac_swap_out      [0:K][0:COLS];
+    wire [IN_WIDTH-1:0]  mac_weight_in     [0:K][0:COLS];
+    wire [IN_WIDTH-1:0]  mac_weight_out    [0:K][0:COLS];
+    wire [OUT_WIDTH-1:0] mac_psum_in       [0:K][0:COLS];
+    wire [OUT_WIDTH-1:0] mac_psum_out      [0:K][0:COLS];
+
+    // input fifo queue signals
+    wire                      fifoin_a_half_full;
+    wire                      fifoin_a_empty;
+    wire [IN_WIDTH*K-1:0]     row_data_in_reg;
+    wire                      swap_weights_reg;
+
+    // output fifo queue signals
+    wire                      fifoout_empty;
+    wire [OUT_WIDTH*COLS-1:0] fifoout_in;
+
+    // weight load and A issue state
+    reg  [$clog2(K+1)-1:0]          shadow_count;      // B rows in the shadow weights
+    reg  [$clog2(SWAP_BUSY+1)-1:0]  swap_busy;
+    reg  [$clog2(OUT_CAPACITY):0]   outstanding;       // issued rows not yet read from the output fifo
+    reg  [PIPE-1:0]                 issue_pipe;
+
+    wire shadow_full = (shadow_count == K);
+    wire weight_load = col_data_in_vld && col_data_in_rdy;
+    wire read_out    = row_data_out_rdy && !fifoout_empty;
+
+    // Issue the head A row when its result has room and, if it starts a new
+    // tile, its weights are all loaded
+    wire issue = !fifoin_a_empty && (outstanding < OUT_CAPACITY) && (!swap_weights_reg || shadow_full);
+
+    assign col_data_in_rdy  = !shadow_full && (swap_busy == 0);
+    assign row_data_in_rdy  = !fifoin_a_half_full;
+    assign row_data_out_vld = !fifoout_empty;
+
+    // Input queue (deal with vld signals)
+    synchronous_fifo #(
+        .DEPTH(8),
+        .DATA_WIDTH(IN_WIDTH*K + 1)
+    ) input_a_fifo (
+        .clk(clk),
+        .rst_n(rst),
+        .w_en(row_data_in_vld && !fifoin_a_half_full),
+        .r_en(issue),
+        .data_in({swap_weights_rdy, row_data_in}),
+        .data_out({swap_weights_reg, row_data_in_reg}),
+        .full(),
+        .half_full(fifoin_a_half_full),
+        .empty(fifoin_a_empty),
+        .almost_full(),
+        .almost_empty()
+    );
+
+    always @(posedge clk) begin
+        if (rst) begin
+            shadow_count <= 0;
+            swap_busy    <= 0;
+            outstanding  <= 0;
+            issue_pipe   <= 0;
+        end else begin
+            // the swap needs a full shadow and loading needs a free one, so the two never coincide
+            if (issue && swap_weights_reg) begin
+                shadow_count <= 0;
+                swap_busy    <= SWAP_BUSY;
+            end else begin
+                if (weight_load)    shadow_count <= shadow_count + 1;
+                if (swap_busy != 0) swap_busy    <= swap_busy - 1;
+            end
+            if (issue && !read_out) begin
+                outstanding <= outstanding + 1;
+            end else if (!issue && read_out) begin
+                outstanding <= outstanding - 1;
+            end
+            issue_pipe <= {issue_pipe[PIPE-2:0], issue};
+        end
+    end
+
+    // Skew A into the wavefront: row k sees the issued row k cycles later,
+    // together with the swap marker
+    wire [(IN_WIDTH+1)*K-1:0] skew_in;
+    wire [(IN_WIDTH+1)*K-1:0] skew_out;
+
+    genvar row, col;
+    generate
+        for (row = 0; row < K; row = row + 1) begin: skew_rows
+            assign skew_in[(IN_WIDTH+1)*row +: IN_WIDTH+1] =
+                issue ? {swap_weights_reg, row_data_in_reg[IN_WIDTH*row +: IN_WIDTH]} : '0;
+        end
+    endgenerate
+
+    skew #(
+        .LANES(K),
+        .WIDTH(IN_WIDTH + 1)
+    ) skew_a (
+        .clk(clk),
+        .rst(rst),
+        .en({K{1'b1}}),
+        .data_in(skew_in),
+        .data_out(skew_out)
+    );
+
+    generate
+        // assign row/column data
+        for (row = 0; row < K; row = row + 1) begin: assign_data_in
+            for (col = 0; col < COLS; col = col + 1) begin: assign_data_in
+                if (col == 0) begin
+                    assign {mac_swap_in[row][0], mac_row_data_in[row][0]} = skew_out[(IN_WIDTH+1)*row +: IN_WIDTH+1];
+                end else begin
+                    assign mac_row_data_in[row][col] = mac_row_data_out[row][col-1];
+                    assign mac_swap_in[row][col]     = mac_swap_out[row][col-1];
+                end
+                if (row == 0) begin
+                    assign mac_psum_in[0][col] = 0;
+                end else begin
+                    assign mac_psum_in[row][col] = mac_psum_out[row-1][col];
+                end
+                // weights enter at the bottom row and shift up
+                if (row == K - 1) begin
+                    assign mac_weight_in[row][col] = col_data_in[IN_WIDTH*col +: IN_WIDTH];
+                end else begin
+                    assign mac_weight_in[row][col] = mac_weight_out[row+1][col];
+                end
+            end
+        end
+
+        // instantiate MAC array
+        for (row = 0; row < K; row = row + 1) begin: instantiate_mac_rows
+            for (col = 0; col < COLS; col = col + 1) begin: instantiate_mac_cols
+                mac_ws #(
+                    .IN_WIDTH(IN_WIDTH),
+                    .IN_FRAC(IN_FRAC),
+                    .OUT_WIDTH(OUT_WIDTH),
+                    .OUT_FRAC(OUT_FRAC),
+                    .MULT_LAT(MULT_LAT),
+                    .ADD_LAT(ACC_LAT)
+                ) mac (
+                    .clk(clk),
+                    .rst(rst),
+                    .weight_in(mac_weight_in[row][col]),
+                    .weight_shift(weight_load),
+                    .row_data_in(mac_row_data_in[row][col]),
+                    .weight_swap_in(mac_swap_in[row][col]),
+                    .psum_in(mac_psum_in[row][col]),
+                    .weight_out(mac_weight_out[row][col]),
+                    .row_data_out(mac_row_data_out[row][col]),
+                    .weight_swap_out(mac_swap_out[row][col]),
+                    .psum_out(mac_psum_out[row][col])
+                );
+            end
+        end
+
+        for (col = 0; col < COLS; col = col + 1) begin: assign_data_out
+            assign fifoout_in[OUT_WIDTH*col +: OUT_WIDTH] = mac_psum_out[K-1][col];
+        end
+    endgenerate
+
+    // Deskew C: column c leaves the bottom row c cycles after column 0
+    wire [OUT_WIDTH*COLS-1:0] deskew_out;
+
+    skew #(
+        .LANES(COLS),
+        .WIDTH(OUT_WIDTH),
+        .DESCENDING(1)
+    ) deskew_c (
+        .clk(clk),
+        .rst(rst),
+        .en({COLS{1'b1}}),
+        .data_in(fifoout_in),
+        .data_out(deskew_out)
+    );
+
+    // Output queue, sized so every issued row has a slot
+    synchronous_fifo #(
+        .DEPTH(OUT_DEPTH),
+        .DATA_WIDTH(OUT_WIDTH*COLS)
+    ) output_fifo (
+        .clk(clk),
+        .rst_n(rst),
+        .w_en(issue_pipe[PIPE-1]),
+        .r_en(read_out),
+        .data_in(deskew_out),
+        .data_out(row_data_out),
+        .full(),
+        .half_full(),
+        .empty(fifoout_empty),
+        .almost_full(),
+        .almost_empty()
+    );
+
+endmodule
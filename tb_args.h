@@ -0,0 +1,46 @@
+// DESCRIPTION:  plusarg helpers shared by the test benches
+//======================================================================
+#ifndef TB_ARGS_H
+#define TB_ARGS_H
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <verilated.h>
+
+// Value of "+name=value" on the command line, or def if absent.
+// name must include the trailing '=' so "+trace=" does not match "+trace_file=".
+inline std::string plusarg_str(const char* name, const std::string& def) {
+    const char* match = Verilated::commandArgsPlusMatch(name);
+    if (!match || !*match) return def;
+    const char* eq = std::strchr(match, '=');
+    return eq ? std::string(eq + 1) : def;
+}
+
+inline uint64_t plusarg_u64(const char* name, uint64_t def) {
+    std::string value = plusarg_str(name, "");
+    return value.empty() ? def : std::strtoull(value.c_str(), nullptr, 0);
+}
+
+inline double plusarg_double(const char* name, double def) {
+    std::string value = plusarg_str(name, "");
+    return value.empty() ? def : std::strtod(value.c_str(), nullptr);
+}
+
+// Comma separated integers of "+name=a,b,c", empty if absent
+inline std::vector<int> plusarg_int_list(const char* name) {
+    std::vector<int> values;
+    std::string value = plusarg_str(name, "");
+    for (size_t pos = 0; pos < value.size();) {
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos) end = value.size();
+        values.push_back((int)std::strtol(value.substr(pos, end - pos).c_str(), nullptr, 0));
+        pos = end + 1;
+    }
+    return values;
+}
+
+#endif // TB_ARGS_H
@@ -0,0 +1,46 @@
+// DESCRIPTION:  runs independent jobs of a batch on a pool of threads
+//======================================================================
+// run_batch(count, threads, job) calls job(i) once for every i in
+// [0, count) on up to `threads` threads and returns when all are done.
+// Jobs are handed out one at a time from a shared counter, so a thread
+// that finishes a short job takes the next one instead of idling while
+// another works through a fixed share; runs of very different length
+// (timeouts, failures that stop early) stay balanced. job must not touch
+// state shared with other jobs; each writes to its own slot of the
+// caller's result arrays.
+//======================================================================
+#ifndef TB_BATCH_H
+#define TB_BATCH_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Default thread count: one per hardware thread
+inline unsigned batch_threads_default() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline void run_batch(uint64_t count, unsigned threads, const std::function<void(uint64_t)>& job) {
+    std::atomic<uint64_t> next(0);
+    auto worker = [&]() {
+        for (uint64_t i = next++; i < count; i = next++) {
+            job(i);
+        }
+    };
+    threads = (unsigned)std::min<uint64_t>(std::max(1u, threads), count);
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    // The calling thread is one of the workers
+    worker();
+    for (std::thread& t : pool) {
+        t.join();
+    }
+}
+
+#endif // TB_BATCH_H
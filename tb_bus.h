@@ -0,0 +1,113 @@
+// DESCRIPTION:  packing of element buffers into Verilator port words
+//======================================================================
+// Verilator keeps ports of up to 64 bits in a plain integer (CData, SData,
+// IData, QData) and wider ports in VlWide<N>, an array of 32-bit words
+// with the least significant word first. Element i of a bus occupies bits
+// [i*WIDTH +: WIDTH], the same layout as row_data_in[IN_WIDTH*row +: IN_WIDTH]
+// in systolic_array.v. Bus<ELEMS, WIDTH> converts between a dense buffer
+// of ELEMS elements (one uint32_t each) and such a port for any WIDTH up
+// to 32, a whole beat at a time; the common 8/16/32-bit widths take a
+// word-at-a-time path the compiler can vectorize.
+//======================================================================
+#ifndef TB_BUS_H
+#define TB_BUS_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#include <verilated.h>
+
+// Scalar ports (up to 64 bits)
+template <class T>
+inline void port_store(T& port, const uint32_t* words, int nwords) {
+    uint64_t v = words[0];
+    if (nwords > 1) v |= (uint64_t)words[1] << 32;
+    port = (T)v;
+}
+
+template <class T>
+inline void port_load(const T& port, uint32_t* words, int nwords) {
+    uint64_t v = (uint64_t)port;
+    words[0] = (uint32_t)v;
+    if (nwords > 1) words[1] = (uint32_t)(v >> 32);
+}
+
+// Wide ports
+template <std::size_t N>
+inline void port_store(VlWide<N>& port, const uint32_t* words, int nwords) {
+    for (int i = 0; i < nwords && i < (int)N; i++) port[i] = words[i];
+}
+
+template <std::size_t N>
+inline void port_load(const VlWide<N>& port, uint32_t* words, int nwords) {
+    for (int i = 0; i < nwords && i < (int)N; i++) words[i] = port[i];
+}
+
+template <int ELEMS, int WIDTH>
+struct Bus {
+    static_assert(WIDTH >= 1 && WIDTH <= 32, "element width must be 1..32 bits");
+
+    static const int      WORDS = (ELEMS * WIDTH + 31) / 32;
+    static const uint32_t MASK  = WIDTH == 32 ? 0xffffffffu : ((1u << (WIDTH % 32)) - 1);
+
+    // Dense elements -> port words
+    static void pack_words(uint32_t* words, const uint32_t* elems) {
+        if (WIDTH == 8 || WIDTH == 16 || WIDTH == 32) {
+            const int per_word = 32 / WIDTH;
+            for (int w = 0; w < WORDS; w++) {
+                uint32_t word = 0;
+                for (int j = 0; j < per_word; j++) {
+                    int e = w * per_word + j;
+                    if (e < ELEMS) word |= (elems[e] & MASK) << (j * WIDTH % 32);
+                }
+                words[w] = word;
+            }
+            return;
+        }
+        uint64_t acc  = 0;
+        int      bits = 0;
+        int      w    = 0;
+        for (int e = 0; e < ELEMS; e++) {
+            acc  |= (uint64_t)(elems[e] & MASK) << bits;
+            bits += WIDTH;
+            if (bits >= 32) {
+                words[w++] = (uint32_t)acc;
+                acc  >>= 32;
+                bits -= 32;
+            }
+        }
+        if (w < WORDS) words[w] = (uint32_t)acc;
+    }
+
+    // Port words -> dense elements
+    static void unpack_words(const uint32_t* words, uint32_t* elems) {
+        if (WIDTH == 8 || WIDTH == 16 || WIDTH == 32) {
+            const int per_word = 32 / WIDTH;
+            for (int e = 0; e < ELEMS; e++)
+                elems[e] = (words[e / per_word] >> (e % per_word * WIDTH % 32)) & MASK;
+            return;
+        }
+        for (int e = 0; e < ELEMS; e++) {
+            int      bit = e * WIDTH;
+            uint64_t v   = words[bit / 32];
+            if (bit % 32 + WIDTH > 32) v |= (uint64_t)words[bit / 32 + 1] << 32;
+            elems[e] = (uint32_t)(v >> (bit % 32)) & MASK;
+        }
+    }
+
+    template <class Port>
+    static void pack(Port& port, const uint32_t* elems) {
+        uint32_t words[WORDS];
+        pack_words(words, elems);
+        port_store(port, words, WORDS);
+    }
+
+    template <class Port>
+    static void unpack(const Port& port, uint32_t* elems) {
+        uint32_t words[WORDS];
+        port_load(port, words, WORDS);
+        unpack_words(words, elems);
+    }
+};
+
+#endif // TB_BUS_H
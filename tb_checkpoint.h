@@ -0,0 +1,93 @@
+// DESCRIPTION:  checkpoint and restore of a verilated bench run
+//======================================================================
+// A checkpoint is one VerilatedSave file: a tag naming the build and run
+// it belongs to, the bench's own state and then the model, which must be
+// verilated with --savable (SAVABLE=1). Restoring checks the tag first,
+// so a checkpoint only loads into the run that wrote it; Verilator checks
+// that the model matches. Files are written to <file>.tmp and renamed,
+// so an interrupted write leaves the previous checkpoint in place.
+//
+//   +checkpoint_at=<cycle>      save once, after clock cycle <cycle>
+//   +checkpoint_every=<cycles>  save after every <cycles> cycles
+//   +checkpoint_file=<file>     where to save (default checkpoint.bin);
+//                               each save replaces the previous one
+//   +restore=<file>             start from <file> instead of reset
+//======================================================================
+#ifndef TB_CHECKPOINT_H
+#define TB_CHECKPOINT_H
+
+#include <iostream>
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+
+#include <verilated_save.h>
+
+#include "tb_args.h"
+
+struct CheckpointArgs {
+    std::string file;
+    uint64_t    at    = 0;
+    uint64_t    every = 0;
+    std::string restore;
+
+    void parse_args() {
+        file    = plusarg_str("checkpoint_file=", "checkpoint.bin");
+        at      = plusarg_u64("checkpoint_at=", 0);
+        every   = plusarg_u64("checkpoint_every=", 0);
+        restore = plusarg_str("restore=", "");
+    }
+
+    bool enabled() const { return at || every || !restore.empty(); }
+
+    // Whether to save after clock cycle `cycle`
+    bool due(uint64_t cycle) const {
+        return cycle == at || (every && cycle % every == 0);
+    }
+};
+
+// Write tag, then whatever write(os) serializes, to file
+template <class Write>
+bool checkpoint_save(const std::string& file, std::string tag, Write write) {
+    const std::string tmp = file + ".tmp";
+    {
+        VerilatedSave os;
+        os.open(tmp.c_str());
+        if (!os.isOpen()) {
+            std::cerr << "ERROR: cannot write " << tmp << std::endl;
+            return false;
+        }
+        os << tag;
+        write(os);
+        os.close();
+    }
+    if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::cerr << "ERROR: cannot rename " << tmp << " to " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Check the tag of file against tag, then let read(is) deserialize the rest
+template <class Read>
+bool checkpoint_restore(const std::string& file, const std::string& tag, Read read) {
+    VerilatedRestore is;
+    is.open(file.c_str());
+    if (!is.isOpen()) {
+        std::cerr << "ERROR: cannot read " << file << std::endl;
+        return false;
+    }
+    std::string saved;
+    is >> saved;
+    if (saved != tag) {
+        std::cerr << "ERROR: " << file << " was saved by another build or run" << std::endl
+                  << "  saved: " << saved << std::endl
+                  << "  this:  " << tag << std::endl;
+        return false;
+    }
+    read(is);
+    is.close();
+    return true;
+}
+
+#endif // TB_CHECKPOINT_H
@@ -0,0 +1,214 @@
+// DESCRIPTION:  tiled GEMM of any M x K x N on one verilated systolic_array
+//======================================================================
+// GemmHost::gemm(a, b, c, m, k, n) computes C = A * B (A m x k, B k x n,
+// C m x n, all row-major) on an array built for ROWS x K x COLS tests.
+// C is cut into ROWSxCOLS output tiles. Every job tells the array its
+// own K, so each tile is one test over the whole reduction, padded up to
+// K when k < K. GemmTileSource can also cut the reduction into chunks,
+// one test per (row block, column block, chunk), chunk innermost; the
+// ragged edges are zero padded. The tests stream back to back through
+// the AXI stream ports without waiting for any result: the array's
+// result queues drain one tile while the next accumulates. Each drained
+// tile is added into its block of C, wrapping at OUT_WIDTH like the
+// array, so a chunked sum equals the full one.
+//
+// The host owns the clock while gemm() runs and keeps the model between
+// calls, so one verilated config serves any number of layer shapes.
+//======================================================================
+#ifndef TB_GEMM_H
+#define TB_GEMM_H
+
+#include <iostream>
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "tb_bus.h"
+#include "tb_golden.h"
+#include "tb_stimulus.h"
+#include "tb_trace.h"
+
+// One gemm() call, compute cycles from the first accepted input beat to the last accepted output beat
+struct GemmStats {
+    uint64_t cycles = 0;
+    uint64_t tiles  = 0;    // array tests, one per (row block, column block, chunk)
+    uint64_t macs   = 0;    // m * k * n, the useful work
+    uint64_t issued = 0;    // tiles * ROWS * COLS * chunk, including the padding
+};
+
+// The tests of one GEMM in issue order
+class GemmTileSource : public TestSource {
+public:
+    // Block of C a test adds into
+    struct Block {
+        int i, j;
+    };
+
+    GemmTileSource(const uint32_t* a, const uint32_t* b, int m, int k, int n, int rows, int cols, int chunk)
+        : a_(a), b_(b), m_(m), k_(k), n_(n), rows_(rows), cols_(cols), chunk_(chunk),
+          m_blocks_((m + rows - 1) / rows), n_blocks_((n + cols - 1) / cols), k_chunks_((k + chunk - 1) / chunk) {}
+
+    uint64_t tests() const { return (uint64_t)m_blocks_ * n_blocks_ * k_chunks_; }
+    int      chunk() const { return chunk_; }
+
+    bool next(TestCase& t) override {
+        if (made_ == tests()) return false;
+        const int kc = (int)(made_ % k_chunks_);
+        const int j  = (int)(made_ / k_chunks_ % n_blocks_);
+        const int i  = (int)(made_ / k_chunks_ / n_blocks_);
+        t.a.assign((size_t)rows_ * chunk_, 0);
+        t.b.assign((size_t)chunk_ * cols_, 0);
+        t.k = chunk_;
+        for (int r = 0; r < rows_ && i * rows_ + r < m_; r++)
+            for (int x = 0; x < chunk_ && kc * chunk_ + x < k_; x++)
+                t.a[(size_t)r * chunk_ + x] = a_[(size_t)(i * rows_ + r) * k_ + kc * chunk_ + x];
+        for (int x = 0; x < chunk_ && kc * chunk_ + x < k_; x++)
+            for (int c = 0; c < cols_ && j * cols_ + c < n_; c++)
+                t.b[(size_t)x * cols_ + c] = b_[(size_t)(kc * chunk_ + x) * n_ + j * cols_ + c];
+        issued_.push_back({i, j});
+        made_++;
+        return true;
+    }
+
+    // Block of the oldest test whose result has not been taken yet
+    Block front() const { return issued_.front(); }
+    void  pop()         { issued_.pop_front(); }
+
+private:
+    const uint32_t* a_;
+    const uint32_t* b_;
+    int m_, k_, n_, rows_, cols_, chunk_;
+    int m_blocks_, n_blocks_, k_chunks_;
+    uint64_t made_ = 0;
+    std::deque<Block> issued_;
+};
+
+template <class Model, int ROWS_, int COLS_, int K_, int IN_W, int OUT_W, int LANES = 1, bool DENSE = false>
+class GemmHost {
+public:
+    // timestamp is the bench's edge counter behind sc_time_stamp(); trace may be null
+    GemmHost(Model* dut, uint64_t& timestamp, TraceWindow* trace, uint64_t run_cycles)
+        : dut_(dut), timestamp_(timestamp), trace_(trace), run_cycles_(run_cycles) {}
+
+    // Hold reset for a few cycles; call once before the first gemm()
+    void reset() {
+        dut_->row_data_in_vld  = 0;
+        dut_->col_data_in_vld  = 0;
+        dut_->row_data_out_rdy = 0;
+        dut_->flush            = 1;
+        dut_->rst              = 1;
+        for (int i = 0; i < 5; i++) tick();
+        dut_->rst = 0;
+        tick();
+    }
+
+    // C = A * B, see above. False on a watchdog timeout.
+    bool gemm(const uint32_t* a, const uint32_t* b, uint32_t* c, int m, int k, int n, GemmStats* stats = nullptr) {
+        const int group = COLS_ / LANES;
+        GemmTileSource source(a, b, m, k, n, ROWS_, COLS_, std::max(k, K_));
+        SkewedStimulus stim(ROWS_, COLS_, K_, source, nullptr, !DENSE);
+        std::fill(c, c + (size_t)m * n, 0);
+
+        const uint64_t expected_beats = source.tests() * group;
+        uint64_t beats_out = 0;
+        uint64_t first_in  = 0;
+        uint64_t last_out  = 0;
+        bool     first_in_seen = source.tests() == 0;
+        bool     a_sent = false;
+        bool     b_sent = false;
+        const uint64_t deadline = cycle_ + run_cycles_;
+
+        while (beats_out < expected_beats && cycle_ < deadline) {
+            // Beats handed over on the edge just taken
+            if (a_sent) stim.advance_a();
+            if (b_sent) stim.advance_b();
+
+            // Flush once the whole stream is handed over, so the last tiles drain
+            dut_->flush = stim.done();
+
+            dut_->row_data_in_vld = !stim.a_done();
+            if (dut_->row_data_in_vld) {
+                Bus<ROWS_, IN_W>::pack(dut_->row_data_in, stim.a_beat());
+                dut_->rst_accumulator_rdy = stim.rst_accumulator();
+                dut_->stream_out_rdy      = stim.stream_out();
+            }
+            dut_->col_data_in_vld = !stim.b_done();
+            if (dut_->col_data_in_vld) {
+                Bus<COLS_, IN_W>::pack(dut_->col_data_in, stim.b_beat());
+            }
+
+            // rdy is registered, so it already tells whether the next edge takes the beat
+            a_sent = dut_->row_data_in_vld && dut_->row_data_in_rdy;
+            b_sent = dut_->col_data_in_vld && dut_->col_data_in_rdy;
+            if (a_sent && !first_in_seen) {
+                first_in      = cycle_ + 1;
+                first_in_seen = true;
+            }
+
+            // Always-ready consumer: every result beat goes into its block of C
+            dut_->row_data_out_rdy = 1;
+            if (dut_->row_data_out_vld) {
+                uint32_t out[ROWS_ * LANES];
+                Bus<ROWS_ * LANES, OUT_W>::unpack(dut_->row_data_out, out);
+                const GemmTileSource::Block blk = source.front();
+                const int beat = (int)(beats_out % group);
+                for (int l = 0; l < LANES; l++) {
+                    const int col = blk.j * COLS_ + l * group + beat;
+                    for (int r = 0; r < ROWS_; r++) {
+                        const int row = blk.i * ROWS_ + r;
+                        if (row >= m || col >= n) continue;
+                        uint32_t& dst = c[(size_t)row * n + col];
+                        dst = wrap((uint64_t)dst + out[l * ROWS_ + r], OUT_W);
+                    }
+                }
+                if (++beats_out % group == 0) source.pop();
+                last_out = cycle_ + 1;
+            }
+
+            tick();
+        }
+
+        // Leave the ports quiet between calls
+        dut_->row_data_in_vld  = 0;
+        dut_->col_data_in_vld  = 0;
+        dut_->row_data_out_rdy = 0;
+
+        if (stats) {
+            stats->cycles = beats_out ? last_out - first_in : 0;
+            stats->tiles  = source.tests();
+            stats->macs   = (uint64_t)m * k * n;
+            stats->issued = source.tests() * ROWS_ * COLS_ * source.chunk();
+        }
+        if (beats_out < expected_beats) {
+            std::cerr << "ERROR: gemm " << m << "x" << k << "x" << n << " timed out after " << run_cycles_
+                      << " cycles with " << beats_out << "/" << expected_beats << " output beats" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Clock cycles since construction
+    uint64_t cycles() const { return cycle_; }
+
+private:
+    // One clock cycle, rising then falling edge: inputs driven before the
+    // call are taken on the rising edge, outputs are read after it
+    void tick() {
+        for (int edge = 0; edge < 2; edge++) {
+            dut_->clk = !dut_->clk;
+            dut_->eval();
+            if (trace_) trace_->sample(timestamp_, cycle_, dut_->row_data_out_vld, false);
+            timestamp_++;
+        }
+        cycle_++;
+    }
+
+    Model*       dut_;
+    uint64_t&    timestamp_;
+    TraceWindow* trace_;
+    uint64_t     run_cycles_;
+    uint64_t     cycle_ = 0;
+};
+
+#endif // TB_GEMM_H
@@ -0,0 +1,162 @@
+// DESCRIPTION:  in-process reference model and streaming result checker
+//======================================================================
+// Computes C = A * B for every test with the arithmetic of mac.v: the
+// multiplier's result mux is unsigned, so IN_WIDTH operands are taken as
+// unsigned, and products and partial sums wrap at OUT_WIDTH. With PACK
+// lanes every element holds PACK independent IN_WIDTH/PACK-bit values and
+// every result PACK OUT_WIDTH/PACK-bit sums, one matrix product per lane.
+// Expected results are queued per test and each accepted row_data_out
+// beat is compared as soon as it leaves the array. With L drain lanes the
+// columns split into L groups of G = cols/L; beat n of a test carries
+// column l*G+n of C for every lane l, one value per row, lane-major.
+// check_row() takes the weight-stationary order instead: beat n of a
+// test is row n of C, one value per column.
+//======================================================================
+#ifndef TB_GOLDEN_H
+#define TB_GOLDEN_H
+
+#include <iostream>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+// Low `width` bits of v, width <= 32
+inline uint32_t wrap(uint64_t v, int width) {
+    return (uint32_t)(v & ((1ull << width) - 1));
+}
+
+class GoldenModel {
+public:
+    GoldenModel(int rows, int cols, int k, int in_width, int out_width, int lanes = 1, int pack = 1)
+        : rows_(rows), cols_(cols), k_(k), in_width_(in_width), out_width_(out_width),
+          lanes_(lanes), group_(cols / lanes), pack_(pack) {}
+
+    // a: rows x k, b: k x cols, both row-major; k = 0 is the k of the model
+    void push_test(const uint32_t* a, const uint32_t* b, int k = 0) {
+        if (k == 0) k = k_;
+        std::vector<uint32_t> c((size_t)rows_ * cols_);
+        for (int r = 0; r < rows_; r++) {
+            for (int col = 0; col < cols_; col++) {
+                // Wrapping at OUT_WIDTH after every step equals wrapping once at the end
+                const int lane_in  = in_width_ / pack_;
+                const int lane_out = out_width_ / pack_;
+                uint32_t result = 0;
+                for (int p = 0; p < pack_; p++) {
+                    uint64_t acc = 0;
+                    for (int i = 0; i < k; i++) {
+                        acc += (uint64_t)wrap(a[r * k + i] >> (p * lane_in), lane_in)
+                             * wrap(b[i * cols_ + col] >> (p * lane_in), lane_in);
+                    }
+                    result |= wrap(acc, lane_out) << (p * lane_out);
+                }
+                c[(size_t)r * cols_ + col] = result;
+            }
+        }
+        expected_.push_back(std::move(c));
+        expected_k_.push_back(k);
+        tests_pushed_++;
+    }
+
+    // Output beats per test
+    int beats_per_test() const { return group_; }
+
+    // Stream the FAILED! reports go to, std::cout by default
+    void set_log(std::ostream* log) { log_ = log; }
+
+    // Compare one accepted beat of rows*lanes output values. On mismatch
+    // the first differing element is reported and false is returned.
+    bool check(const uint32_t* out, uint64_t cycle) {
+        if (expected_.empty()) {
+            *log_ << "FAILED! unexpected output beat at cycle " << cycle
+                  << " after " << tests_checked_ << " tests" << std::endl;
+            return false;
+        }
+        const std::vector<uint32_t>& c = expected_.front();
+        for (int l = 0; l < lanes_; l++) {
+            int col = l * group_ + col_;
+            for (int r = 0; r < rows_; r++) {
+                uint32_t want = c[(size_t)r * cols_ + col];
+                uint32_t got  = out[l * rows_ + r];
+                if (got != want) {
+                    *log_ << "FAILED! test=" << tests_checked_ << " row=" << r << " col=" << col
+                          << " expected=" << want << " got=" << got
+                          << " cycle=" << cycle << std::endl;
+                    return false;
+                }
+            }
+        }
+        next_col();
+        return true;
+    }
+
+    // Count `beats` beats in check() order as checked without comparing
+    // them, e.g. the beats checked before a checkpoint. False if fewer
+    // results are expected.
+    bool skip(uint64_t beats) {
+        for (uint64_t i = 0; i < beats; i++) {
+            if (expected_.empty()) return false;
+            next_col();
+        }
+        return true;
+    }
+
+    // Compare one accepted beat holding a whole row of C, cols values
+    bool check_row(const uint32_t* out, uint64_t cycle) {
+        if (expected_.empty()) {
+            *log_ << "FAILED! unexpected output beat at cycle " << cycle
+                  << " after " << tests_checked_ << " tests" << std::endl;
+            return false;
+        }
+        const std::vector<uint32_t>& c = expected_.front();
+        for (int col = 0; col < cols_; col++) {
+            uint32_t want = c[(size_t)row_ * cols_ + col];
+            if (out[col] != want) {
+                *log_ << "FAILED! test=" << tests_checked_ << " row=" << row_ << " col=" << col
+                      << " expected=" << want << " got=" << out[col]
+                      << " cycle=" << cycle << std::endl;
+                return false;
+            }
+        }
+        beats_checked_++;
+        if (++row_ == rows_) {
+            row_ = 0;
+            expected_.pop_front();
+            steps_checked_ += expected_k_.front();
+            expected_k_.pop_front();
+            tests_checked_++;
+        }
+        return true;
+    }
+
+    uint64_t tests_pushed()  const { return tests_pushed_; }
+    uint64_t tests_checked() const { return tests_checked_; }
+    uint64_t beats_checked() const { return beats_checked_; }
+    // Sum of K over the checked tests, the MACs of each PE lane
+    uint64_t steps_checked() const { return steps_checked_; }
+
+private:
+    // One beat of check() done: move to the next column, or the next test
+    void next_col() {
+        beats_checked_++;
+        if (++col_ == group_) {
+            col_ = 0;
+            expected_.pop_front();
+            steps_checked_ += expected_k_.front();
+            expected_k_.pop_front();
+            tests_checked_++;
+        }
+    }
+
+    int rows_, cols_, k_, in_width_, out_width_, lanes_, group_, pack_;
+    std::ostream* log_ = &std::cout;
+    std::deque<std::vector<uint32_t>> expected_;
+    std::deque<int> expected_k_;
+    int      col_           = 0;
+    int      row_           = 0;
+    uint64_t tests_pushed_  = 0;
+    uint64_t tests_checked_ = 0;
+    uint64_t beats_checked_ = 0;
+    uint64_t steps_checked_ = 0;
+};
+
+#endif // TB_GOLDEN_H
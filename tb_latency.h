@@ -0,0 +1,135 @@
+// DESCRIPTION:  per-test end-to-end latency statistics
+//======================================================================
+// Each test matrix is admitted on the cycle its first A beat is accepted
+// on row_data_in and completes on the cycle its last column leaves on
+// row_data_out. Tests are admitted and completed in order, so only the
+// admission cycles of tests still in flight are kept; the latencies
+// themselves are kept for exact percentiles.
+//
+// The report gives min, p50, p99, max and mean plus a histogram of
+// equal-width bins between min and max, as text and optionally JSON.
+//======================================================================
+#ifndef TB_LATENCY_H
+#define TB_LATENCY_H
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+class LatencyTracker {
+public:
+    explicit LatencyTracker(int bins = 20) : bins_(std::max(bins, 1)) {}
+
+    // Tests must be admitted in order: test n after test n-1
+    void admit(uint64_t test, uint64_t cycle) {
+        if (test != first_pending_ + admitted_.size()) return;
+        admitted_.push_back(cycle);
+    }
+
+    // Tests complete in order as well
+    void complete(uint64_t test, uint64_t cycle) {
+        if (test != first_pending_ || admitted_.empty()) return;
+        latencies_.push_back(cycle - admitted_.front());
+        admitted_.pop_front();
+        first_pending_++;
+    }
+
+    uint64_t count() const { return latencies_.size(); }
+
+    // Checkpoint support (tb_checkpoint.h): Out/In take uint64_t through
+    // << / >>, as VerilatedSave and VerilatedRestore do
+    template <class Out>
+    void save(Out& os) {
+        uint64_t admitted = admitted_.size();
+        uint64_t done     = latencies_.size();
+        os << first_pending_ << admitted << done;
+        for (uint64_t& v : admitted_) os << v;
+        for (uint64_t& v : latencies_) os << v;
+    }
+
+    template <class In>
+    void restore(In& is) {
+        uint64_t admitted, done;
+        is >> first_pending_ >> admitted >> done;
+        admitted_.assign(admitted, 0);
+        latencies_.assign(done, 0);
+        for (uint64_t& v : admitted_) is >> v;
+        for (uint64_t& v : latencies_) is >> v;
+    }
+
+    void report(std::ostream& os) {
+        summarize();
+        os << "Latency over " << latencies_.size() << " tests (cycles): min=" << min_
+           << " p50=" << p50_ << " p99=" << p99_ << " max=" << max_ << " mean=" << mean_ << std::endl;
+        if (latencies_.empty()) return;
+        uint64_t peak = *std::max_element(hist_.begin(), hist_.end());
+        for (size_t i = 0; i < hist_.size(); i++) {
+            uint64_t lo = min_ + i * width_;
+            os << "  [" << std::setw(8) << lo << ", " << std::setw(8) << lo + width_ << ") "
+               << std::setw(8) << hist_[i] << " " << std::string(peak ? 40 * hist_[i] / peak : 0, '#')
+               << std::endl;
+        }
+    }
+
+    bool write_json(const std::string& path) {
+        summarize();
+        std::ofstream f(path);
+        if (!f) return false;
+        f << "{\n"
+          << "  \"tests\": " << latencies_.size() << ",\n"
+          << "  \"min\": " << min_ << ",\n"
+          << "  \"p50\": " << p50_ << ",\n"
+          << "  \"p99\": " << p99_ << ",\n"
+          << "  \"max\": " << max_ << ",\n"
+          << "  \"mean\": " << mean_ << ",\n"
+          << "  \"bin_width\": " << width_ << ",\n"
+          << "  \"histogram\": [";
+        for (size_t i = 0; i < hist_.size(); i++) {
+            f << (i ? ", " : "") << "{\"lo\": " << min_ + i * width_ << ", \"count\": " << hist_[i] << "}";
+        }
+        f << "]\n}\n";
+        return true;
+    }
+
+private:
+    // Nearest-rank percentile of the sorted latencies
+    uint64_t percentile(const std::vector<uint64_t>& sorted, double p) const {
+        size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+        return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+    }
+
+    void summarize() {
+        hist_.clear();
+        if (latencies_.empty()) return;
+        std::vector<uint64_t> sorted(latencies_);
+        std::sort(sorted.begin(), sorted.end());
+        min_ = sorted.front();
+        max_ = sorted.back();
+        p50_ = percentile(sorted, 50);
+        p99_ = percentile(sorted, 99);
+        double sum = 0;
+        for (uint64_t v : sorted) sum += v;
+        mean_ = sum / sorted.size();
+
+        // Equal-width bins covering [min, max]
+        uint64_t span = max_ - min_ + 1;
+        width_ = (span + bins_ - 1) / bins_;
+        hist_.assign((span + width_ - 1) / width_, 0);
+        for (uint64_t v : sorted) hist_[(v - min_) / width_]++;
+    }
+
+    int bins_;
+    std::deque<uint64_t>  admitted_;
+    uint64_t              first_pending_ = 0;
+    std::vector<uint64_t> latencies_;
+    std::vector<uint64_t> hist_;
+    uint64_t min_ = 0, p50_ = 0, p99_ = 0, max_ = 0, width_ = 1;
+    double   mean_ = 0;
+};
+
+#endif // TB_LATENCY_H
@@ -0,0 +1,119 @@
+// DESCRIPTION:  host-side tile scheduler for systolic_array_cluster
+//======================================================================
+// A GEMM C = A * B with A m x k and B k x n, k the arrays' K, is cut
+// into rows x cols tiles of C, tile (i, j) covering rows i*rows.. and
+// columns j*cols.. . Each tile is one test of one array: the row block
+// of A and the column block of B go in, the tile of C comes out.
+//
+// With distributed B any array can take any tile, and tiles are handed
+// out from one queue on demand, when an array's input stream reaches
+// its next test. An array that falls behind simply takes fewer tiles,
+// so all arrays stay busy until the queue runs dry.
+//
+// With a shared B every array consumes the same B stream, so tiles go
+// out in rounds: round r is column block r / groups and the row blocks
+// of group r % groups, one per array. Slots past the last row block are
+// idle tiles: the shared B with an A of zeros, whose results are checked
+// and then ignored.
+//======================================================================
+#ifndef TB_SCHEDULER_H
+#define TB_SCHEDULER_H
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+
+#include "tb_stimulus.h"
+
+// Operands of the whole GEMM, row-major
+struct Gemm {
+    int m, n, k;
+    std::vector<uint32_t> a;
+    std::vector<uint32_t> b;
+
+    // Seeded uniform random operands with data_bits-wide elements
+    Gemm(int m_, int n_, int k_, uint64_t seed, int data_bits) : m(m_), n(n_), k(k_) {
+        std::mt19937_64 rng(seed);
+        std::uniform_int_distribution<uint32_t> dist(0, (1u << data_bits) - 1);
+        a.resize((size_t)m * k);
+        b.resize((size_t)k * n);
+        for (uint32_t& v : a) v = dist(rng);
+        for (uint32_t& v : b) v = dist(rng);
+    }
+};
+
+// Tile (row block, column block) of C; idle tiles have no row block
+struct Tile {
+    int  i, j;
+    bool idle;
+};
+
+class TileScheduler {
+public:
+    TileScheduler(int m_tiles, int n_tiles, int arrays, bool shared_b)
+        : m_tiles_(m_tiles), n_tiles_(n_tiles), arrays_(arrays), shared_b_(shared_b),
+          groups_((m_tiles + arrays - 1) / arrays), taken_(arrays, 0), real_(arrays, 0) {}
+
+    // Next tile for `array`, false once it has none left
+    bool next(int array, Tile& t) {
+        if (shared_b_) {
+            uint64_t round = taken_[array];
+            if (round >= (uint64_t)groups_ * n_tiles_) return false;
+            t.j    = (int)(round / groups_);
+            t.i    = (int)(round % groups_) * arrays_ + array;
+            t.idle = t.i >= m_tiles_;
+        } else {
+            if (queued_ >= (uint64_t)m_tiles_ * n_tiles_) return false;
+            t.i    = (int)(queued_ / n_tiles_);
+            t.j    = (int)(queued_ % n_tiles_);
+            t.idle = false;
+            queued_++;
+        }
+        taken_[array]++;
+        if (!t.idle) real_[array]++;
+        return true;
+    }
+
+    uint64_t tiles() const { return (uint64_t)m_tiles_ * n_tiles_; }
+
+    // Tiles handed to `array`, with and without the idle ones
+    uint64_t taken(int array) const { return taken_[array]; }
+    uint64_t real(int array)  const { return real_[array]; }
+
+private:
+    int  m_tiles_, n_tiles_, arrays_;
+    bool shared_b_;
+    int  groups_;
+    uint64_t queued_ = 0;
+    std::vector<uint64_t> taken_;
+    std::vector<uint64_t> real_;
+};
+
+// The tiles of one array as its test source
+class TileSource : public TestSource {
+public:
+    TileSource(const Gemm& gemm, TileScheduler& scheduler, int array, int rows, int cols)
+        : gemm_(gemm), scheduler_(scheduler), array_(array), rows_(rows), cols_(cols) {}
+
+    bool next(TestCase& t) override {
+        Tile tile;
+        if (!scheduler_.next(array_, tile)) return false;
+        const int k = gemm_.k;
+        t.a.assign((size_t)rows_ * k, 0);
+        t.b.assign((size_t)k * cols_, 0);
+        for (int r = 0; r < rows_ && !tile.idle; r++)
+            for (int i = 0; i < k; i++)
+                t.a[(size_t)r * k + i] = gemm_.a[(size_t)(tile.i * rows_ + r) * k + i];
+        for (int i = 0; i < k; i++)
+            for (int c = 0; c < cols_; c++)
+                t.b[(size_t)i * cols_ + c] = gemm_.b[(size_t)i * gemm_.n + tile.j * cols_ + c];
+        return true;
+    }
+
+private:
+    const Gemm&    gemm_;
+    TileScheduler& scheduler_;
+    int array_, rows_, cols_;
+};
+
+#endif // TB_SCHEDULER_H
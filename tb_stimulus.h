@@ -0,0 +1,298 @@
+// DESCRIPTION:  on-the-fly stimulus for the systolic_array bench
+//======================================================================
+// Test matrices are produced one at a time by a TestSource and turned
+// into the skewed row/column beats the array expects: beat t of row r
+// carries A[r][t-r] and beat t of column c carries B[t-c][c], with the
+// tests of a run laid back to back along K and zero padding at the
+// edges. Every test may have its own K, which reaches the array only
+// through the rst_accumulator/stream_out bits on its first and last
+// beat. Only the tests still covered by the skew window are kept, so
+// memory does not grow with the number of tests. For an array built
+// with INPUT_SKEW the staircase is made inside the array, so the beats
+// are left dense (beat t of row r carries A[r][t]) and unpadded.
+//
+// DenseStimulus feeds systolic_array_ws instead: one dense row of A per
+// beat, and one row of B per beat, sent once per group of tests sharing
+// the same B.
+//======================================================================
+#ifndef TB_STIMULUS_H
+#define TB_STIMULUS_H
+
+#include <iostream>
+#include <stdint.h>
+#include <cstdlib>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "tb_golden.h"
+
+// One test's operands: a is rows x k, b is k x cols, both row-major.
+// k = 0 means the k the stimulus was built with.
+struct TestCase {
+    std::vector<uint32_t> a;
+    std::vector<uint32_t> b;
+    int k = 0;
+};
+
+// Supplies test matrices in order; next() returns false once exhausted
+class TestSource {
+public:
+    virtual ~TestSource() {}
+    virtual bool next(TestCase& t) = 0;
+};
+
+// Seeded uniform random matrices with data_bits-wide non-negative elements.
+// With pack > 1 each element packs `pack` such values, lane_width bits apart.
+// A new B is drawn every b_reuse tests and repeated in between, the
+// batch-of-A workload where one weight matrix meets many inputs.
+// set_job_k() gives the tests their own K, cycling through a list.
+class RandomSource : public TestSource {
+public:
+    RandomSource(int rows, int cols, int k, uint64_t num_tests, uint64_t seed, int data_bits,
+                 int pack = 1, int lane_width = 0, uint64_t b_reuse = 1)
+        : rows_(rows), cols_(cols), k_(k), pack_(pack), lane_width_(lane_width), num_tests_(num_tests),
+          b_reuse_(std::max(b_reuse, (uint64_t)1)), rng_(seed), dist_(0, (1u << data_bits) - 1) {}
+
+    // K of test n is job_k[n % job_k.size()]; empty: k for every test
+    void set_job_k(const std::vector<int>& job_k) { job_k_ = job_k; }
+
+    bool next(TestCase& t) override {
+        if (made_ == num_tests_) return false;
+        const int k = job_k_.empty() ? k_ : job_k_[made_ % job_k_.size()];
+        t.k = k;
+        t.a.resize((size_t)rows_ * k);
+        for (uint32_t& v : t.a) v = element();
+        // A B of another K cannot be reused
+        if (made_ % b_reuse_ == 0 || b_.size() != (size_t)k * cols_) {
+            b_.resize((size_t)k * cols_);
+            for (uint32_t& v : b_) v = element();
+        }
+        t.b = b_;
+        made_++;
+        return true;
+    }
+
+private:
+    uint32_t element() {
+        uint32_t v = dist_(rng_);
+        for (int p = 1; p < pack_; p++) v |= dist_(rng_) << (p * lane_width_);
+        return v;
+    }
+
+    int rows_, cols_, k_, pack_, lane_width_;
+    uint64_t num_tests_;
+    uint64_t b_reuse_;
+    uint64_t made_ = 0;
+    std::vector<int> job_k_;
+    std::vector<uint32_t> b_;
+    std::mt19937_64 rng_;
+    std::uniform_int_distribution<uint32_t> dist_;
+};
+
+// Lazily emits the skewed A (row_data_in) and B (col_data_in) beats, or
+// the dense ones with skewed = false. The A and B sides advance
+// independently, as their AXI streams do.
+class SkewedStimulus {
+public:
+    SkewedStimulus(int rows, int cols, int k, TestSource& source, GoldenModel* golden, bool skewed = true)
+        : rows_(rows), cols_(cols), k_(k), skewed_(skewed), source_(source), golden_(golden),
+          a_beat_(rows), b_beat_(cols) {}
+
+    bool a_done() { return beat_a_ >= total_beats(beat_a_); }
+    bool b_done() { return beat_b_ >= total_beats(beat_b_); }
+    bool done()   { return a_done() && b_done(); }
+
+    // Elements of the current A beat, one per row, plus its sideband bits
+    const uint32_t* a_beat() {
+        for (int r = 0; r < rows_; r++)
+            a_beat_[r] = element(beat_a_, r, true);
+        return a_beat_.data();
+    }
+    // First and last beat of a test, never set on the padding
+    bool rst_accumulator() {
+        int n = locate(beat_a_);
+        return n >= 0 && beat_a_ == starts_[n];
+    }
+    bool stream_out() {
+        int n = locate(beat_a_);
+        return n >= 0 && beat_a_ == starts_[n] + tests_[n].k - 1;
+    }
+
+    // Test of the current A beat (row 0), only valid while !a_done()
+    uint64_t test_a() { return first_test_ + std::max(locate(beat_a_), 0); }
+
+    // Elements of the current B beat, one per column
+    const uint32_t* b_beat() {
+        for (int c = 0; c < cols_; c++)
+            b_beat_[c] = element(beat_b_, c, false);
+        return b_beat_.data();
+    }
+
+    void advance_a() { beat_a_++; retire(); }
+    void advance_b() { beat_b_++; retire(); }
+
+    uint64_t beat_a() const { return beat_a_; }
+    uint64_t beat_b() const { return beat_b_; }
+
+    // Move on to A beat a and B beat b as if every beat before them had
+    // been handed over, fetching (and handing the golden model) each test
+    // on the way, in the order a run would. Rebuilds the stimulus of a
+    // checkpoint from the seed.
+    void skip_to(uint64_t a, uint64_t b) {
+        while (beat_a_ < a || beat_b_ < b) {
+            if (beat_a_ < a) { a_done(); advance_a(); }
+            if (beat_b_ < b) { b_done(); advance_b(); }
+        }
+    }
+
+private:
+    // Beats in the whole stream, known once the source runs dry; until
+    // then it is reported as just past the beat being asked about
+    uint64_t total_beats(uint64_t beat) {
+        while (!exhausted_ && beat >= end_)
+            fetch();
+        if (!exhausted_) return beat + 1;
+        return end_ + (skewed_ ? std::max(rows_, cols_) : 0);
+    }
+
+    // Beats by which a lane trails lane 0
+    uint64_t lag(int lane) const { return skewed_ ? lane : 0; }
+
+    void fetch() {
+        TestCase t;
+        if (!source_.next(t)) {
+            exhausted_ = true;
+            return;
+        }
+        if (t.k == 0) t.k = k_;
+        if (golden_) golden_->push_test(t.a.data(), t.b.data(), t.k);
+        starts_.push_back(end_);
+        end_ += t.k;
+        tests_.push_back(std::move(t));
+    }
+
+    // Index into tests_ of the test holding stream step i, -1 outside the kept tests
+    int locate(uint64_t i) {
+        while (!exhausted_ && i >= end_)
+            fetch();
+        if (tests_.empty() || i < starts_.front() || i >= end_) return -1;
+        // Only the few tests inside the skew window are kept
+        int n = (int)tests_.size() - 1;
+        while (starts_[n] > i) n--;
+        return n;
+    }
+
+    // A[lane][i] (is_a) or B[i][lane] for stream beat `beat`, zero outside the data
+    uint32_t element(uint64_t beat, int lane, bool is_a) {
+        if (beat < lag(lane)) return 0;
+        uint64_t i = beat - lag(lane);
+        int n = locate(i);
+        if (n < 0) return 0;
+        const TestCase& t = tests_[n];
+        int kk = (int)(i - starts_[n]);
+        return is_a ? t.a[(size_t)lane * t.k + kk] : t.b[(size_t)kk * cols_ + lane];
+    }
+
+    // Drop tests neither side can reach any more
+    void retire() {
+        uint64_t lo_a = beat_a_ >= lag(rows_ - 1) ? beat_a_ - lag(rows_ - 1) : 0;
+        uint64_t lo_b = beat_b_ >= lag(cols_ - 1) ? beat_b_ - lag(cols_ - 1) : 0;
+        uint64_t lo = std::min(lo_a, lo_b);
+        while (!tests_.empty() && starts_.front() + tests_.front().k <= lo) {
+            tests_.pop_front();
+            starts_.pop_front();
+            first_test_++;
+        }
+    }
+
+    int rows_, cols_, k_;
+    bool         skewed_;
+    TestSource&  source_;
+    GoldenModel* golden_;
+    std::deque<TestCase> tests_;
+    std::deque<uint64_t> starts_;       // first stream step of each kept test
+    uint64_t first_test_ = 0;
+    uint64_t end_        = 0;           // first stream step after the fetched tests
+    bool     exhausted_  = false;
+    uint64_t beat_a_     = 0;
+    uint64_t beat_b_     = 0;
+    std::vector<uint32_t> a_beat_;
+    std::vector<uint32_t> b_beat_;
+};
+
+// Dense A and B beats for the weight-stationary array. A beat n*rows+r
+// is row r of test n's A; the first row of every b_reuse-th test carries
+// the swap to the B loaded for it. B beat t*k+i is row i of the B shared
+// by tests t*b_reuse .. (t+1)*b_reuse-1. As above, the two sides advance
+// independently; B runs at most one group ahead, so up to b_reuse tests
+// are kept.
+class DenseStimulus {
+public:
+    DenseStimulus(int rows, int cols, int k, uint64_t num_tests, uint64_t b_reuse, TestSource& source,
+                  GoldenModel* golden)
+        : rows_(rows), cols_(cols), k_(k), num_tests_(num_tests), b_reuse_(std::max(b_reuse, (uint64_t)1)),
+          source_(source), golden_(golden) {}
+
+    bool a_done() const { return beat_a_ / rows_ >= num_tests_; }
+    bool b_done() const { return (beat_b_ / k_) * b_reuse_ >= num_tests_; }
+    bool done()   const { return a_done() && b_done(); }
+
+    // Row of A for the current A beat, k elements
+    const uint32_t* a_beat() {
+        const TestCase& t = test(beat_a_ / rows_);
+        return &t.a[(size_t)(beat_a_ % rows_) * k_];
+    }
+    bool swap_weights() const {
+        return beat_a_ % rows_ == 0 && (beat_a_ / rows_) % b_reuse_ == 0;
+    }
+
+    // Row of B for the current B beat, cols elements
+    const uint32_t* b_beat() {
+        const TestCase& t = test((beat_b_ / k_) * b_reuse_);
+        return &t.b[(size_t)(beat_b_ % k_) * cols_];
+    }
+
+    void advance_a() { beat_a_++; retire(); }
+    void advance_b() { beat_b_++; retire(); }
+
+    uint64_t beat_a() const { return beat_a_; }
+    uint64_t beat_b() const { return beat_b_; }
+
+private:
+    // Test n, fetched from the source on first use
+    const TestCase& test(uint64_t n) {
+        while (n >= first_test_ + tests_.size()) {
+            TestCase t;
+            if (!source_.next(t)) {
+                std::cerr << "ERROR: test source ran dry at test " << n << std::endl;
+                exit(1);
+            }
+            if (golden_) golden_->push_test(t.a.data(), t.b.data());
+            tests_.push_back(std::move(t));
+        }
+        return tests_[n - first_test_];
+    }
+
+    // Drop tests neither side can reach any more
+    void retire() {
+        uint64_t lo = std::min(beat_a_ / rows_, (beat_b_ / k_) * b_reuse_);
+        while (first_test_ < lo && !tests_.empty()) {
+            tests_.pop_front();
+            first_test_++;
+        }
+    }
+
+    int rows_, cols_, k_;
+    uint64_t     num_tests_;
+    uint64_t     b_reuse_;
+    TestSource&  source_;
+    GoldenModel* golden_;
+    std::deque<TestCase> tests_;
+    uint64_t first_test_ = 0;
+    uint64_t beat_a_     = 0;
+    uint64_t beat_b_     = 0;
+};
+
+#endif // TB_STIMULUS_H
@@ -0,0 +1,169 @@
+// DESCRIPTION:  run-time controlled, windowed waveform tracing
+//======================================================================
+// The trace backend is chosen at build time (TRACE_FMT in the Makefile
+// defines TRACE_FST or TRACE_VCD); whether anything is dumped, and which
+// window of the run, is chosen at run time:
+//
+//   +trace=off|fst|vcd      format, must match the backend built in (default off)
+//   +trace_file=<name>      output file (default trace.fst / trace.vcd)
+//   +trace_start=<cycle>    earliest cycle to open the window (default 0)
+//   +trace_stop=<cycle>     cycle to close the window (default never)
+//   +trace_trigger=<event>  open on the first out_vld or stall at/after start
+//   +trace_cycles=<n>       close the window n cycles after it opened
+//   +trace_depth=<levels>   hierarchy depth to trace (default 99)
+//======================================================================
+#ifndef TB_TRACE_H
+#define TB_TRACE_H
+
+#include <iostream>
+#include <stdint.h>
+#include <cstdlib>
+#include <string>
+
+#include <verilated.h>
+#ifdef TRACE_FST
+#include <verilated_fst_c.h>
+#endif
+#ifdef TRACE_VCD
+#include <verilated_vcd_c.h>
+#endif
+
+#include "tb_args.h"
+
+class TraceWindow {
+public:
+    enum Trigger { TRIGGER_NONE, TRIGGER_OUT_VLD, TRIGGER_STALL };
+
+    // Read the +trace* plusargs; exits on a format this build cannot write
+    void parse_args() {
+        format_ = plusarg_str("trace=", "off");
+        if (format_ == "off") return;
+#ifdef TRACE_FST
+        const bool fst_ok = true;
+#else
+        const bool fst_ok = false;
+#endif
+#ifdef TRACE_VCD
+        const bool vcd_ok = true;
+#else
+        const bool vcd_ok = false;
+#endif
+        if ((format_ == "fst" && !fst_ok) || (format_ == "vcd" && !vcd_ok)) {
+            std::cerr << "ERROR: +trace=" << format_ << " not built in, rebuild with TRACE_FMT="
+                      << format_ << std::endl;
+            exit(1);
+        }
+        if (format_ != "fst" && format_ != "vcd") {
+            std::cerr << "ERROR: unknown +trace=" << format_ << ", expected off, fst or vcd" << std::endl;
+            exit(1);
+        }
+
+        file_   = plusarg_str("trace_file=", "trace." + format_);
+        start_  = plusarg_u64("trace_start=", 0);
+        stop_   = plusarg_u64("trace_stop=", UINT64_MAX);
+        cycles_ = plusarg_u64("trace_cycles=", 0);
+        depth_  = (int)plusarg_u64("trace_depth=", 99);
+
+        std::string trigger = plusarg_str("trace_trigger=", "none");
+        if (trigger == "out_vld")    trigger_ = TRIGGER_OUT_VLD;
+        else if (trigger == "stall") trigger_ = TRIGGER_STALL;
+        else if (trigger != "none") {
+            std::cerr << "ERROR: unknown +trace_trigger=" << trigger << ", expected out_vld or stall" << std::endl;
+            exit(1);
+        }
+        Verilated::traceEverOn(true);
+    }
+
+    bool enabled() const { return format_ != "off"; }
+
+    // Attach to the model; nothing is dumped until the window opens
+    template <class Model>
+    void open(Model* dut) {
+        if (!enabled()) return;
+#ifdef TRACE_FST
+        if (format_ == "fst") {
+            fst_ = new VerilatedFstC();
+            dut->trace(fst_, depth_);
+            fst_->open(file_.c_str());
+        }
+#endif
+#ifdef TRACE_VCD
+        if (format_ == "vcd") {
+            vcd_ = new VerilatedVcdC();
+            dut->trace(vcd_, depth_);
+            vcd_->open(file_.c_str());
+        }
+#endif
+        (void)dut;
+    }
+
+    // Call once per clock edge, after eval(); cycle counts clock cycles after reset
+    void sample(uint64_t time, uint64_t cycle, bool out_vld, bool stall) {
+        if (!enabled() || closed_) return;
+        if (!active_) {
+            bool fired = trigger_ == TRIGGER_NONE
+                      || (trigger_ == TRIGGER_OUT_VLD && out_vld)
+                      || (trigger_ == TRIGGER_STALL && stall);
+            if (cycle < start_ || !fired) return;
+            active_    = true;
+            opened_at_ = cycle;
+            std::cout << "Trace window opened at cycle " << cycle << " (" << file_ << ")" << std::endl;
+        }
+        if (cycle >= stop_ || (cycles_ && cycle >= opened_at_ + cycles_)) {
+            active_ = false;
+            closed_ = true;
+            std::cout << "Trace window closed at cycle " << cycle << std::endl;
+            flush();
+            return;
+        }
+        dump(time);
+    }
+
+    void close() {
+#ifdef TRACE_FST
+        if (fst_) { fst_->close(); delete fst_; fst_ = nullptr; }
+#endif
+#ifdef TRACE_VCD
+        if (vcd_) { vcd_->close(); delete vcd_; vcd_ = nullptr; }
+#endif
+    }
+
+private:
+    void dump(uint64_t time) {
+#ifdef TRACE_FST
+        if (fst_) fst_->dump(time);
+#endif
+#ifdef TRACE_VCD
+        if (vcd_) vcd_->dump(time);
+#endif
+        (void)time;
+    }
+
+    void flush() {
+#ifdef TRACE_FST
+        if (fst_) fst_->flush();
+#endif
+#ifdef TRACE_VCD
+        if (vcd_) vcd_->flush();
+#endif
+    }
+
+    std::string format_     = "off";
+    std::string file_;
+    uint64_t    start_      = 0;
+    uint64_t    stop_       = UINT64_MAX;
+    uint64_t    cycles_     = 0;
+    uint64_t    opened_at_  = 0;
+    int         depth_      = 99;
+    Trigger     trigger_    = TRIGGER_NONE;
+    bool        active_     = false;
+    bool        closed_     = false;
+#ifdef TRACE_FST
+    VerilatedFstC* fst_ = nullptr;
+#endif
+#ifdef TRACE_VCD
+    VerilatedVcdC* vcd_ = nullptr;
+#endif
+};
+
+#endif // TB_TRACE_H
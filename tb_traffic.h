@@ -0,0 +1,198 @@
+// DESCRIPTION:  seeded ready/valid traffic models for the AXI stream ports
+//======================================================================
+// A Traffic model answers, once per clock cycle, whether a port is
+// willing: whether the consumer raises row_data_out_rdy, or whether the
+// producer has a beat to offer on row_data_in / col_data_in. Models are
+// built from a spec string, usually given as a plusarg:
+//
+//   always                  every cycle
+//   duty:<p>                each cycle independently with probability p
+//   bursty:<on>:<off>       on/off bursts of geometric length, mean <on> and <off> cycles
+//   periodic:<on>:<off>     <on> cycles on, then <off> cycles off, repeating
+//   replay:<file>           one '0'/'1' per cycle from <file> (other characters
+//                           are skipped), looping at the end
+//
+// Random models draw from their own seeded generator, so a run is
+// reproducible from its seeds.
+//
+// CreditLink is the sender side of a credit-flow input (CREDIT_FLOW):
+// instead of waiting on rdy the sender spends one credit per beat and
+// gets every credit back from the array after the link latency.
+//======================================================================
+#ifndef TB_TRAFFIC_H
+#define TB_TRAFFIC_H
+
+#include <iostream>
+#include <fstream>
+#include <stdint.h>
+#include <cstdlib>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+class Traffic {
+public:
+    virtual ~Traffic() {}
+    // Willingness for the next cycle
+    virtual bool next() = 0;
+    // Move on by `cycles` answers, e.g. to the cycle of a checkpoint
+    void skip(uint64_t cycles) {
+        for (uint64_t i = 0; i < cycles; i++) next();
+    }
+};
+
+class AlwaysTraffic : public Traffic {
+public:
+    bool next() override { return true; }
+};
+
+class DutyTraffic : public Traffic {
+public:
+    DutyTraffic(double p, uint64_t seed) : rng_(seed), dist_(p) {}
+    bool next() override { return dist_(rng_); }
+
+private:
+    std::mt19937_64 rng_;
+    std::bernoulli_distribution dist_;
+};
+
+class BurstyTraffic : public Traffic {
+public:
+    // Leaving a state with probability 1/mean gives bursts of the given mean length
+    BurstyTraffic(double on_mean, double off_mean, uint64_t seed)
+        : rng_(seed), leave_on_(1.0 / std::max(on_mean, 1.0)), leave_off_(1.0 / std::max(off_mean, 1.0)) {}
+    bool next() override {
+        bool now = on_;
+        if (on_ ? leave_on_(rng_) : leave_off_(rng_)) on_ = !on_;
+        return now;
+    }
+
+private:
+    std::mt19937_64 rng_;
+    std::bernoulli_distribution leave_on_, leave_off_;
+    bool on_ = true;
+};
+
+class PeriodicTraffic : public Traffic {
+public:
+    PeriodicTraffic(uint64_t on, uint64_t off) : on_(on), period_(on + off) {}
+    bool next() override {
+        bool now = phase_ < on_;
+        if (++phase_ >= period_) phase_ = 0;
+        return now;
+    }
+
+private:
+    uint64_t on_, period_;
+    uint64_t phase_ = 0;
+};
+
+class ReplayTraffic : public Traffic {
+public:
+    explicit ReplayTraffic(const std::vector<bool>& trace) : trace_(trace) {}
+    bool next() override {
+        bool now = trace_[pos_];
+        if (++pos_ == trace_.size()) pos_ = 0;
+        return now;
+    }
+
+private:
+    std::vector<bool> trace_;
+    size_t pos_ = 0;
+};
+
+// Builds the model named by spec; exits with a message on a bad spec
+inline std::unique_ptr<Traffic> make_traffic(const std::string& spec, uint64_t seed, const char* port) {
+    std::vector<std::string> f;
+    size_t start = 0;
+    for (;;) {
+        size_t colon = spec.find(':', start);
+        f.push_back(spec.substr(start, colon - start));
+        if (colon == std::string::npos) break;
+        start = colon + 1;
+    }
+    auto num = [&](size_t i) { return i < f.size() ? std::strtod(f[i].c_str(), nullptr) : -1.0; };
+
+    if (f[0] == "always" && f.size() == 1) {
+        return std::unique_ptr<Traffic>(new AlwaysTraffic());
+    }
+    if (f[0] == "duty" && f.size() == 2 && num(1) >= 0 && num(1) <= 1) {
+        return std::unique_ptr<Traffic>(new DutyTraffic(num(1), seed));
+    }
+    if (f[0] == "bursty" && f.size() == 3 && num(1) >= 1 && num(2) >= 1) {
+        return std::unique_ptr<Traffic>(new BurstyTraffic(num(1), num(2), seed));
+    }
+    if (f[0] == "periodic" && f.size() == 3 && num(1) >= 1 && num(2) >= 0) {
+        return std::unique_ptr<Traffic>(new PeriodicTraffic((uint64_t)num(1), (uint64_t)num(2)));
+    }
+    if (f[0] == "replay" && f.size() >= 2) {
+        // The file name may itself contain ':'
+        std::string path = spec.substr(spec.find(':') + 1);
+        std::ifstream in(path);
+        std::vector<bool> trace;
+        char c;
+        while (in.get(c)) {
+            if (c == '0' || c == '1') trace.push_back(c == '1');
+        }
+        if (trace.empty()) {
+            std::cerr << "ERROR: " << port << ": no 0/1 samples in replay file " << path << std::endl;
+            exit(1);
+        }
+        return std::unique_ptr<Traffic>(new ReplayTraffic(trace));
+    }
+    std::cerr << "ERROR: " << port << ": bad traffic model '" << spec
+              << "', expected always, duty:<p>, bursty:<on>:<off>, periodic:<on>:<off> or replay:<file>"
+              << std::endl;
+    exit(1);
+}
+
+// Credits held by the sender of one input stream. It starts with the
+// receiver's free slots; a credit raised by the receiver arrives
+// `latency` cycles later, modelling the return path of a remote link.
+class CreditLink {
+public:
+    CreditLink(int credits, int latency) : credits_(credits), pipe_(latency, false) {}
+
+    // Once per cycle, with the receiver's credit output of that cycle
+    void tick(bool credit) {
+        pipe_.push_back(credit);
+        credits_ += pipe_.front();
+        pipe_.pop_front();
+    }
+
+    bool available() const { return credits_ > 0; }
+    void spend()           { credits_--; }
+    int  credits()   const { return credits_; }
+
+    // Checkpoint support (tb_checkpoint.h): Out/In take uint64_t and bool
+    // through << / >>, as VerilatedSave and VerilatedRestore do
+    template <class Out>
+    void save(Out& os) {
+        uint64_t credits = (uint64_t)credits_;
+        uint64_t size    = pipe_.size();
+        os << credits << size;
+        for (bool credit : pipe_) os << credit;
+    }
+
+    template <class In>
+    void restore(In& is) {
+        uint64_t credits, size;
+        is >> credits >> size;
+        credits_ = (int)credits;
+        pipe_.clear();
+        for (uint64_t i = 0; i < size; i++) {
+            bool credit;
+            is >> credit;
+            pipe_.push_back(credit);
+        }
+    }
+
+private:
+    int credits_;
+    std::deque<bool> pipe_;
+};
+
+#endif // TB_TRAFFIC_H
@@ -0,0 +1,190 @@
+// DESCRIPTION:  arbitrary M x K x N GEMMs on one verilated systolic_array
+//======================================================================
+// Runs every shape of +shapes= (comma separated MxKxN, e.g. layer shapes)
+// through GemmHost (tb_gemm.h) on the same model, checks each C against
+// a host reference, and reports the achieved MACs per cycle against the
+// array's peak of ROWS*COLS per cycle. Only m*k*n counts as useful work;
+// the zero padding of ragged tiles is reported separately.
+//======================================================================
+#include <iostream>
+#include <stdint.h>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Include common routines
+#include <verilated.h>
+// Include model header, generated from Verilating "systolic_array.v"
+#include "Vsystolic_array.h"
+
+// Perf flavor: no tracing in the hot loop
+#ifdef PERF_MODE
+#undef TRACE_FST
+#undef TRACE_VCD
+#define BUILD_FLAVOR "perf"
+#else
+#define BUILD_FLAVOR "debug"
+#endif
+
+#include "tb_args.h"
+#include "tb_gemm.h"
+#include "tb_golden.h"
+#include "tb_trace.h"
+
+// Watchdog per GEMM, in clock cycles (+run_cycles=)
+#define RUN_CYCLES 10000000
+
+// Defaults for +shapes= / +seed= / +data_bits=
+#define SHAPES "64x64x64,100x147x96,49x512x10,256x9x32"
+#ifndef SEED
+#define SEED 1
+#endif
+#define DATA_BITS 3
+
+#ifndef IN_WIDTH
+#define IN_WIDTH 8
+#endif
+#ifndef OUT_WIDTH
+#define OUT_WIDTH 8
+#endif
+
+// Output lanes per row (-GDRAIN_LANES)
+#ifndef DRAIN_LANES
+#define DRAIN_LANES 1
+#endif
+static_assert(COLS % DRAIN_LANES == 0, "DRAIN_LANES must divide COLS");
+
+// Model built with -GINPUT_SKEW=1: the array skews its inputs, beats are sent dense
+#ifndef INPUT_SKEW
+#define INPUT_SKEW 0
+#endif
+
+// Current simulation time (64-bit unsigned)
+uint64_t timestamp = 0;
+
+double sc_time_stamp() {
+  return timestamp;
+}
+
+struct Shape {
+    int m, k, n;
+};
+
+std::vector<Shape> parse_shapes(const std::string& text) {
+    std::vector<Shape> shapes;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        Shape s;
+        char x1, x2;
+        std::stringstream is(item);
+        if (!(is >> s.m >> x1 >> s.k >> x2 >> s.n) || x1 != 'x' || x2 != 'x' || s.m < 1 || s.k < 1 || s.n < 1) {
+            std::cerr << "ERROR: improper shape " << item << " in +shapes=, expected MxKxN" << std::endl;
+            exit(1);
+        }
+        shapes.push_back(s);
+    }
+    return shapes;
+}
+
+int main(int argc, char** argv, char** env) {
+    // turn off unused variable warnings
+    if (0 && argc && argv && env) {}
+
+    Verilated::commandArgs(argc, argv);
+
+    // Tracing is chosen at run time and must be enabled before the model is built
+    TraceWindow trace;
+    trace.parse_args();
+
+    // Construct the Verilated model
+    Vsystolic_array* dut = new Vsystolic_array();
+
+    const std::vector<Shape> shapes = parse_shapes(plusarg_str("shapes=", SHAPES));
+    const uint64_t seed       = plusarg_u64("seed=", SEED);
+    const int      data_bits  = std::min((int)plusarg_u64("data_bits=", DATA_BITS), IN_WIDTH);
+    const uint64_t run_cycles = plusarg_u64("run_cycles=", RUN_CYCLES);
+    const double   peak       = (double)ROWS * COLS;
+
+    trace.open(dut);
+
+    GemmHost<Vsystolic_array, ROWS, COLS, K, IN_WIDTH, OUT_WIDTH, DRAIN_LANES, INPUT_SKEW> host(dut, timestamp, &trace, run_cycles);
+    host.reset();
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<uint32_t> dist(0, (1u << data_bits) - 1);
+
+    uint64_t total_cycles = 0;
+    uint64_t total_macs   = 0;
+    int      passed       = 0;
+    bool     failed       = false;
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    std::cout << "Array " << ROWS << "x" << COLS << " K=" << K << ", peak " << peak << " MACs/cycle" << std::endl;
+    for (const Shape& s : shapes) {
+        std::vector<uint32_t> a((size_t)s.m * s.k), b((size_t)s.k * s.n), c((size_t)s.m * s.n);
+        for (uint32_t& v : a) v = dist(rng);
+        for (uint32_t& v : b) v = dist(rng);
+
+        GemmStats stats;
+        bool ok = host.gemm(a.data(), b.data(), c.data(), s.m, s.k, s.n, &stats);
+
+        // Reference with the array's arithmetic: unsigned operands, sums wrapping at OUT_WIDTH
+        for (int r = 0; r < s.m && ok; r++) {
+            for (int col = 0; col < s.n && ok; col++) {
+                uint64_t acc = 0;
+                for (int i = 0; i < s.k; i++) acc += (uint64_t)a[(size_t)r * s.k + i] * b[(size_t)i * s.n + col];
+                uint32_t want = wrap(acc, OUT_WIDTH);
+                if (c[(size_t)r * s.n + col] != want) {
+                    std::cout << "FAILED! gemm " << s.m << "x" << s.k << "x" << s.n << " row=" << r << " col=" << col
+                              << " expected=" << want << " got=" << c[(size_t)r * s.n + col] << std::endl;
+                    ok = false;
+                }
+            }
+        }
+
+        double rate = stats.cycles ? (double)stats.macs / stats.cycles : 0;
+        std::cout << "GEMM " << s.m << "x" << s.k << "x" << s.n << ": tiles=" << stats.tiles
+                  << " cycles=" << stats.cycles << " macs/cycle=" << rate
+                  << " efficiency=" << 100 * rate / peak << "%"
+                  << " padding=" << (stats.issued ? 100.0 * (stats.issued - stats.macs) / stats.issued : 0) << "%"
+                  << (ok ? " ok" : " FAILED") << std::endl;
+        total_cycles += stats.cycles;
+        total_macs   += stats.macs;
+        if (ok) passed++;
+        failed = failed || !ok;
+    }
+
+    double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    std::cout << "Build=" << BUILD_FLAVOR << std::endl;
+    std::cout << "Cycles=" << total_cycles << std::endl;
+    std::cout << "MACs=" << total_macs << std::endl;
+    std::cout << "PeakMACsPerCycle=" << peak << std::endl;
+    std::cout << "MACsPerCycle=" << (total_cycles ? (double)total_macs / total_cycles : 0) << std::endl;
+    std::cout << "WallTime=" << wall_time << "s" << std::endl;
+    // Simulation throughput over every clock cycle evaluated
+    std::cout << "CyclesPerSec=" << (wall_time > 0 ? host.cycles() / wall_time : 0) << std::endl;
+
+    // Final model cleanup
+    dut->final();
+
+    trace.close();
+
+    // Destroy DUT
+    delete dut;
+
+    if (!failed) {
+        std::cout << "PASSED! " << passed << " gemms" << std::endl;
+    } else {
+        std::cout << "FAILED!" << std::endl;
+    }
+
+    // Fin
+    exit(failed ? 1 : 0);
+}
@@ -1,77 +1,265 @@
 // DESCRIPTION:  simulation of systolic_array 
 //======================================================================
 #include <iostream>
-#include <fstream>
 #include <stdint.h>
 #include <cstdlib> 
-#include <ctime>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 // Include common routines
 #include <verilated.h>
 // Include model header, generated from Verilating "systolic_array.v"
 #include "Vsystolic_array.h"
 #include "Vsystolic_array__Syms.h"
+#include "Vsystolic_array___024root.h"
 
-#ifdef VCD_OUTPUT
-#include <verilated_vcd_c.h>
+// Perf flavor: no tracing or debug prints in the hot loop
+#ifdef PERF_MODE
+#undef TRACE_FST
+#undef TRACE_VCD
+#undef DPRINTF
+#define BUILD_FLAVOR "perf"
+#else
+#define BUILD_FLAVOR "debug"
 #endif
 
-#define RUN_CYCLES 10000000
+#include "tb_args.h"
+#include "tb_batch.h"
+#include "tb_checkpoint.h"
+#include "tb_bus.h"
+#include "tb_golden.h"
+#include "tb_latency.h"
+#include "tb_stimulus.h"
+#include "tb_trace.h"
+#include "tb_traffic.h"
 
-#define CLOCK_PERIOD 2
+// Watchdog, in clock edges: give up if the expected results have not drained by then (+run_cycles=)
+#define RUN_CYCLES 10000000
 
 #define RESET_TIME  10
 
-// Current simulation time (64-bit unsigned)
+// Default traffic on the AXI stream ports (+out_rdy= / +a_vld= / +b_vld=, see tb_traffic.h)
+#define OUT_RDY_TRAFFIC "duty:0.333"
+#define IN_VLD_TRAFFIC  "always"
+
+// Defaults for +num_tests= / +seed= / +data_bits=
+#ifndef NUM_TESTS
+#define NUM_TESTS 1
+#endif
+#ifndef SEED
+#define SEED 1
+#endif
+#define DATA_BITS 3
+
+#ifndef IN_WIDTH
+#define IN_WIDTH 8
+#endif
+#ifndef OUT_WIDTH
+#define OUT_WIDTH 8
+#endif
+
+// Output lanes per row (-GDRAIN_LANES), each beat carries ROWS*DRAIN_LANES values
+#ifndef DRAIN_LANES
+#define DRAIN_LANES 1
+#endif
+static_assert(COLS % DRAIN_LANES == 0, "DRAIN_LANES must divide COLS");
+
+// Packed lanes per element (-GPACK): 2 = dual-INT4, 4 = quad-INT2 for 8-bit elements
+#ifndef PACK
+#define PACK 1
+#endif
+static_assert(IN_WIDTH % PACK == 0 && OUT_WIDTH % PACK == 0, "PACK must divide IN_WIDTH and OUT_WIDTH");
+
+// Model built with -GINPUT_SKEW=1: the array skews its inputs, beats are sent dense
+#ifndef INPUT_SKEW
+#define INPUT_SKEW 0
+#endif
+
+// Model built with -GCREDIT_FLOW=1: the inputs are sent against credits
+// instead of rdy, starting from the -GIN_FIFO_DEPTH free slots
+#ifndef CREDIT_FLOW
+#define CREDIT_FLOW 0
+#endif
+#ifndef IN_FIFO_DEPTH
+#define IN_FIFO_DEPTH 8
+#endif
+
+// Model built with -GPERF_COUNTERS=1, perf_* outputs are live
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 0
+#endif
+
+// Model verilated with --savable: runs can be checkpointed and restored
+// (+checkpoint_at= / +checkpoint_every= / +restore=, see tb_checkpoint.h)
+#ifndef SAVABLE
+#define SAVABLE 0
+#endif
+
+// Current simulation time (64-bit unsigned) of the single run; batch runs
+// keep their own clocks
 uint64_t timestamp = 0;
-uint64_t systolic_steps = 0;
 
 double sc_time_stamp() { 
   return timestamp;
 }
 
-int main(int argc, char** argv, char** env) {
-    // turn off unused variable warnings
-    if (0 && argc && argv && env) {}
-
-    // Construct the Verilated model
-    Vsystolic_array* dut = new Vsystolic_array();
+// Global stall inside the array, marked public in systolic_array.v
+static inline bool dut_stall(Vsystolic_array* dut) {
+    return dut->rootp->systolic_array__DOT__stall;
+}
 
-    //load a_matrix.bin using ifstream
+// Snapshot of the perf_* counters of systolic_array
+struct PerfCounters {
+    uint64_t cycles, active, out_stall, mac_stall, starve_a, starve_b, out_beats;
 
-    std::ifstream a_matrix_bin("a_matrix.bin", std::ios::binary);
-    if (!a_matrix_bin) {
-        std::cerr << "ERROR: could not open a_matrix.bin" << std::endl;
-        exit(1);
+    static PerfCounters read(const Vsystolic_array* dut) {
+        return {dut->perf_cycles, dut->perf_active_cycles, dut->perf_out_stall_cycles,
+                dut->perf_mac_stall_cycles, dut->perf_starve_a_cycles, dut->perf_starve_b_cycles,
+                dut->perf_out_beats};
     }
-    //load b_matrix.bin using ifstream
-    std::ifstream b_matrix_bin("b_matrix.bin", std::ios::binary);
-    if (!b_matrix_bin) {
-        std::cerr << "ERROR: could not open b_matrix.bin" << std::endl;
-        exit(1);
+
+    PerfCounters operator-(const PerfCounters& o) const {
+        return {cycles - o.cycles, active - o.active, out_stall - o.out_stall, mac_stall - o.mac_stall,
+                starve_a - o.starve_a, starve_b - o.starve_b, out_beats - o.out_beats};
     }
-    //load c_matrix.bin using ifstream
-    std::ifstream c_matrix_bin("c_matrix.bin", std::ios::binary);
-    if (!c_matrix_bin) {
-        std::cerr << "ERROR: could not open c_matrix.bin" << std::endl;
-        exit(1);
+};
+
+// Utilization breakdown; the five categories partition the cycles
+void print_utilization(const PerfCounters& p) {
+    std::cout << "Utilization over " << p.cycles << " cycles:" << std::endl;
+    auto line = [&](const char* name, uint64_t n) {
+        std::cout << "  " << std::left << std::setw(10) << name << std::right << std::setw(12) << n
+                  << std::fixed << std::setprecision(1) << std::setw(8)
+                  << (p.cycles ? 100.0 * n / p.cycles : 0.0) << "%" << std::endl;
+    };
+    line("active", p.active);
+    line("out_stall", p.out_stall);
+    line("mac_stall", p.mac_stall);
+    line("starve_a", p.starve_a);
+    line("starve_b", p.starve_b);
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    std::cout << "PerfOutBeats=" << p.out_beats << std::endl;
+}
+
+// Run settings shared by every seed, read from the plusargs once
+struct BenchArgs {
+    uint64_t         num_tests;
+    int              data_bits;
+    uint64_t         run_cycles;
+    uint64_t         b_reuse;
+    std::vector<int> job_k;
+    int              latency_bins;
+    std::string      out_rdy, a_vld, b_vld;
+    bool             fixed_traffic_seed;
+    uint64_t         traffic_seed;
+    int              credit_latency;
+    CheckpointArgs   checkpoint;
+
+    static BenchArgs parse() {
+        BenchArgs args;
+        args.num_tests  = plusarg_u64("num_tests=", NUM_TESTS);
+        args.data_bits  = std::min((int)plusarg_u64("data_bits=", DATA_BITS), IN_WIDTH / PACK);
+        args.run_cycles = plusarg_u64("run_cycles=", RUN_CYCLES);
+        // Tests sharing one B; the array still streams B for every test
+        args.b_reuse    = plusarg_u64("b_reuse=", 1);
+        // K of each job, cycled through test by test (+job_k=16,64,...). The
+        // array is sized for jobs of at least the K it was built with (-GK).
+        args.job_k      = plusarg_int_list("job_k=");
+        for (int k : args.job_k) {
+            if (k < K) {
+                std::cerr << "ERROR: +job_k= value " << k << " is below K=" << K << " the model was built for" << std::endl;
+                exit(1);
+            }
+        }
+        // Per-test latency, first A beat accepted to last output beat accepted (+latency_bins=)
+        args.latency_bins = (int)plusarg_u64("latency_bins=", 20);
+        // Ready/valid traffic, reproducible from +traffic_seed= (default the run's seed)
+        args.out_rdy = plusarg_str("out_rdy=", OUT_RDY_TRAFFIC);
+        args.a_vld   = plusarg_str("a_vld=", IN_VLD_TRAFFIC);
+        args.b_vld   = plusarg_str("b_vld=", IN_VLD_TRAFFIC);
+        args.fixed_traffic_seed = plusarg_str("traffic_seed=", "") != "";
+        args.traffic_seed       = plusarg_u64("traffic_seed=", 0);
+        // Credit return latency of both input links, in cycles (+credit_latency=)
+        args.credit_latency = (int)plusarg_u64("credit_latency=", 0);
+        // Bad traffic specs exit here rather than from a batch thread
+        make_traffic(args.out_rdy, 0, "+out_rdy");
+        make_traffic(args.a_vld, 0, "+a_vld");
+        make_traffic(args.b_vld, 0, "+b_vld");
+        args.checkpoint.parse_args();
+        return args;
     }
-    //store generated results.bin using ofstream
-    std::ofstream results("results.bin", std::ios::binary);
-    if (!results) {
-        std::cerr << "ERROR: could not open results.bin" << std::endl;
-        exit(1);
+
+    // Names the build and run of `seed`; a checkpoint only restores into
+    // the same one
+    std::string tag(uint64_t seed) const {
+        std::ostringstream os;
+        os << "systolic_array " << BUILD_FLAVOR << " ROWS=" << ROWS << " COLS=" << COLS << " K=" << K
+           << " IN_WIDTH=" << IN_WIDTH << " OUT_WIDTH=" << OUT_WIDTH << " DRAIN_LANES=" << DRAIN_LANES
+           << " PACK=" << PACK << " INPUT_SKEW=" << INPUT_SKEW << " CREDIT_FLOW=" << CREDIT_FLOW
+           << " PERF_COUNTERS=" << PERF_COUNTERS << " seed=" << seed << " num_tests=" << num_tests
+           << " data_bits=" << data_bits << " b_reuse=" << b_reuse << " job_k=";
+        for (size_t i = 0; i < job_k.size(); i++) os << (i ? "," : "") << job_k[i];
+        os << " out_rdy=" << out_rdy << " a_vld=" << a_vld << " b_vld=" << b_vld
+           << " traffic_seed=" << (fixed_traffic_seed ? traffic_seed : seed)
+           << " credit_latency=" << credit_latency;
+        return os.str();
     }
+};
 
-#ifdef VCD_OUTPUT
-    Verilated::traceEverOn(true);
-    auto trace = new VerilatedVcdC();
-    dut->trace(trace, 2999);
-    trace->open("trace.vcd");
-#endif
+// Outcome of one seed
+struct RunResult {
+    uint64_t     seed           = 0;
+    bool         done           = false;
+    bool         failed         = false;
+    uint64_t     cycles         = 0;  // first accepted input beat to last accepted output beat
+    uint64_t     steps          = 0;  // clock cycles evaluated after reset
+    uint64_t     steps_run      = 0;  // of those, simulated by this run rather than restored
+    uint64_t     beats_out      = 0;
+    uint64_t     expected_beats = 0;
+    uint64_t     stall_cycles   = 0;
+    uint64_t     beats_a        = 0;
+    uint64_t     beats_b        = 0;
+    uint64_t     macs           = 0;
+    uint64_t     tests_checked  = 0;
+    double       wall_time      = 0;
+    PerfCounters perf           = {};
 
-#ifdef DPRINTF
-    uint64_t timestamp_WB = 0;
+    bool passed() const { return done && !failed; }
+};
+
+// Simulate `seed` on a freshly built dut from reset, or from the checkpoint
+// in +restore=, until every result has been checked, a check fails or the
+// watchdog fires. time counts the model's clock edges; mismatches are
+// reported to log. Everything the run touches is local or owned by the
+// dut, so runs on different models can go in parallel.
+RunResult run_seed(Vsystolic_array* dut, uint64_t seed, const BenchArgs& args, uint64_t& time,
+                   TraceWindow* trace, LatencyTracker& latency, std::ostream& log) {
+    RunResult r;
+    r.seed = seed;
+
+    // Each test drains COLS/DRAIN_LANES output beats of ROWS*DRAIN_LANES values each
+    const uint64_t beats_per_test = COLS / DRAIN_LANES;
+    r.expected_beats = beats_per_test * args.num_tests;
+
+    GoldenModel    golden(ROWS, COLS, K, IN_WIDTH, OUT_WIDTH, DRAIN_LANES, PACK);
+    RandomSource   source(ROWS, COLS, K, args.num_tests, seed, args.data_bits, PACK, IN_WIDTH / PACK, args.b_reuse);
+    SkewedStimulus stim(ROWS, COLS, K, source, &golden, !INPUT_SKEW);
+    source.set_job_k(args.job_k);
+    golden.set_log(&log);
+
+    const uint64_t traffic_seed = args.fixed_traffic_seed ? args.traffic_seed : seed;
+    std::unique_ptr<Traffic> out_rdy = make_traffic(args.out_rdy, traffic_seed, "+out_rdy");
+    std::unique_ptr<Traffic> a_vld   = make_traffic(args.a_vld, traffic_seed + 1, "+a_vld");
+    std::unique_ptr<Traffic> b_vld   = make_traffic(args.b_vld, traffic_seed + 2, "+b_vld");
+#if CREDIT_FLOW
+    CreditLink a_credits(IN_FIFO_DEPTH, args.credit_latency);
+    CreditLink b_credits(IN_FIFO_DEPTH, args.credit_latency);
 #endif
 
     dut->clk = 0;
@@ -80,145 +268,385 @@ int main(int argc, char** argv, char** env) {
     dut->col_data_in_vld = 0;
     dut->row_data_out_rdy = 0;
 
-    int counter = 0;
-    srand( time(NULL) );
-    bool not_starting_a = true;
-    bool not_starting_b = true;
+    // Handshakes decided after the previous rising edge, taken on this one
+    bool a_sent = false;
+    bool b_sent = false;
 
-    while (timestamp < RUN_CYCLES) {      
-        bool clk_transition = (timestamp % CLOCK_PERIOD) == 0;
-        if (clk_transition) 
-            dut->clk = !dut->clk; 
+    // Run-to-completion bookkeeping, in clock cycles after reset
+    uint64_t steps           = 0;
+    uint64_t first_in_cycle  = 0;
+    uint64_t last_out_cycle  = 0;
+    bool     first_in_seen   = false;
+    PerfCounters perf_start  = {};
 
-        if (timestamp > 1 && timestamp < RESET_TIME) {
-            dut->rst = 1;  // Assert reset
-        } else {
-            dut->rst = 0;  // Deassert reset
+#if SAVABLE
+    // Bench state at a cycle boundary. Stimulus, traffic and checker are
+    // rebuilt from the seed on restore, so only their positions are kept.
+    auto save_state = [&](VerilatedSerialize& os) {
+        uint64_t stim_a  = stim.beat_a();
+        uint64_t stim_b  = stim.beat_b();
+        uint64_t checked = golden.beats_checked();
+        os << time << steps << a_sent << b_sent << first_in_seen << first_in_cycle << stim_a << stim_b << checked
+           << r.beats_out << r.beats_a << r.beats_b << r.stall_cycles
+           << perf_start.cycles << perf_start.active << perf_start.out_stall << perf_start.mac_stall
+           << perf_start.starve_a << perf_start.starve_b << perf_start.out_beats;
+        latency.save(os);
+#if CREDIT_FLOW
+        a_credits.save(os);
+        b_credits.save(os);
+#endif
+        os << *dut;
+    };
+
+    if (!args.checkpoint.restore.empty()) {
+        uint64_t stim_a, stim_b, checked;
+        auto restore_state = [&](VerilatedDeserialize& is) {
+            is >> time >> steps >> a_sent >> b_sent >> first_in_seen >> first_in_cycle >> stim_a >> stim_b >> checked
+               >> r.beats_out >> r.beats_a >> r.beats_b >> r.stall_cycles
+               >> perf_start.cycles >> perf_start.active >> perf_start.out_stall >> perf_start.mac_stall
+               >> perf_start.starve_a >> perf_start.starve_b >> perf_start.out_beats;
+            latency.restore(is);
+#if CREDIT_FLOW
+            a_credits.restore(is);
+            b_credits.restore(is);
+#endif
+            is >> *dut;
+        };
+        if (!checkpoint_restore(args.checkpoint.restore, args.tag(seed), restore_state)) {
+            exit(1);
+        }
+        // Replay the seed up to the checkpoint: every traffic model answers once per cycle
+        stim.skip_to(stim_a, stim_b);
+        if (!golden.skip(checked)) {
+            std::cerr << "ERROR: " << args.checkpoint.restore << " has more checked beats than the run" << std::endl;
+            exit(1);
         }
-        
+        out_rdy->skip(steps);
+        a_vld->skip(steps);
+        b_vld->skip(steps);
+        log << "Restored " << args.checkpoint.restore << " at cycle " << steps << std::endl;
+    }
+    bool save_due = false;
+#endif
+    const uint64_t first_step = steps;
+
+    // Tracing starts here, so a restored run is traced from its checkpoint on
+    if (trace) trace->open(dut);
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    while (time < args.run_cycles && !r.done && !r.failed) {
+        // One model evaluation per clock edge; time counts edges
+        dut->clk = !dut->clk;
+
+        // Reset only changes on the falling edge, away from the sampling edge
+        if (!dut->clk) {
+            dut->rst = (time > 1 && time < RESET_TIME);
+        }
+
         // Evaluate model
         dut->eval();
-        
-        // Verilator allows to access verilator public data structure
-        if (clk_transition && dut->clk) {
-            if(timestamp > RESET_TIME){
-                /*** Deal with input signals ***/
-                // Flush the pipeline telling no further input data
-                if (a_matrix_bin.eof() && b_matrix_bin.eof() && timestamp > RUN_CYCLES/4) {
-                    dut->flush = 1;
-                } else {
-                    dut->flush = 0;
-                }
-                
 
-                // Set dut->row_data_in valid or not
-                if (not_starting_a || (!a_matrix_bin.eof() && rand() % 1 == 0)) { // randomly drop data
-                    dut->row_data_in_vld = 1;
-                } else {
-                    dut->row_data_in_vld = 0;
+        // Drive the next beat right after the rising edge
+        if (dut->clk && time > RESET_TIME) {
+#if PERF_COUNTERS
+            // Counters from here on cover the edges after the first beat's,
+            // the same span as r.cycles
+            if (first_in_seen && steps == first_in_cycle) perf_start = PerfCounters::read(dut);
+#endif
+
+            /*** Deal with input signals ***/
+            // A beat offered but not taken stays valid, as AXI stream requires
+            const bool a_hold = dut->row_data_in_vld && !a_sent;
+            const bool b_hold = dut->col_data_in_vld && !b_sent;
+            bool a_want = a_vld->next();
+            bool b_want = b_vld->next();
+#if CREDIT_FLOW
+            // Credits raised on the edge just taken, after the link latency;
+            // a beat is only offered against a credit and is always taken
+            a_credits.tick(dut->row_data_in_credit);
+            b_credits.tick(dut->col_data_in_credit);
+            a_want = a_want && a_credits.available();
+            b_want = b_want && b_credits.available();
+#endif
+
+            // Beats handed over on the edge just taken
+            if (a_sent) stim.advance_a();
+            if (b_sent) stim.advance_b();
+
+            // Flush once the whole stream is handed over, so the array drains
+            // instead of waiting on the empty input fifos
+            dut->flush = stim.done();
+
+            // Present the next A beat with its rst_accumulator/stream_out sideband
+            dut->row_data_in_vld = !stim.a_done() && (a_hold || a_want);
+            if (dut->row_data_in_vld) {
+                Bus<ROWS, IN_WIDTH>::pack(dut->row_data_in, stim.a_beat());
+                dut->rst_accumulator_rdy = stim.rst_accumulator();
+                dut->stream_out_rdy      = stim.stream_out();
+            }
+
+            // Present the next B beat
+            dut->col_data_in_vld = !stim.b_done() && (b_hold || b_want);
+            if (dut->col_data_in_vld) {
+                Bus<COLS, IN_WIDTH>::pack(dut->col_data_in, stim.b_beat());
+            }
+
+#if CREDIT_FLOW
+            a_sent = dut->row_data_in_vld;
+            b_sent = dut->col_data_in_vld;
+            if (a_sent) a_credits.spend();
+            if (b_sent) b_credits.spend();
+            // A credit always stands for a free slot, so the fifo can never be full here
+            if ((a_sent && !dut->row_data_in_rdy) || (b_sent && !dut->col_data_in_rdy)) {
+                log << "FAILED! input fifo overrun with credits at cycle " << steps << std::endl;
+                r.failed = true;
+            }
+#else
+            // rdy is registered, so it already tells whether the next edge takes the beat
+            a_sent = dut->row_data_in_vld && dut->row_data_in_rdy;
+            b_sent = dut->col_data_in_vld && dut->col_data_in_rdy;
+#endif
+            if (a_sent) r.beats_a++;
+            if (b_sent) r.beats_b++;
+            // Row 0 carries the first element of every test
+            if (a_sent && stim.rst_accumulator()) {
+                latency.admit(stim.test_a(), steps + 1);
+            }
+            if (a_sent && !first_in_seen) {
+                first_in_cycle = steps + 1;
+                first_in_seen  = true;
+            }
+
+            /*** Deal with output signals ***/
+            // Consumer side of row_data_out
+            dut->row_data_out_rdy = out_rdy->next();
+
+            // Check dut->row_data_out against the reference
+            if (dut->row_data_out_vld && dut->row_data_out_rdy) { // transfer when vld && rdy
+                uint32_t out[ROWS * DRAIN_LANES];
+                Bus<ROWS * DRAIN_LANES, OUT_WIDTH>::unpack(dut->row_data_out, out);
+                if (!golden.check(out, steps)) {
+                    r.failed = true;
                 }
-                
-                // Set dut->col_data_in valid or not
-                if (not_starting_b || (!b_matrix_bin.eof() && rand() % 1 == 0)) { // randomly drop data
-                    dut->col_data_in_vld = 1;
-                } else  {
-                    dut->col_data_in_vld = 0;
+                // The beat is taken on the next rising edge
+                if (++r.beats_out % beats_per_test == 0) {
+                    latency.complete(r.beats_out / beats_per_test - 1, steps + 1);
                 }
-
-                // Deal with rst_accumulator, stream_out signals, 
-                // and read a_matrix.bin to dut->row_data_in util end of file
-                if (not_starting_a || (dut->row_data_in_vld && dut->row_data_in_rdy)) {
-                    if (!a_matrix_bin.eof()) {
-                        a_matrix_bin.read(reinterpret_cast<char*>(&dut->row_data_in), ROWS);
-                        if (counter % K == 0)  dut->rst_accumulator_rdy = 1;
-                        else                   dut->rst_accumulator_rdy = 0;
-                        if (counter % K == K-1)  dut->stream_out_rdy = 1;
-                        else                     dut->stream_out_rdy = 0;
-                        counter++;
-                    }
-                    not_starting_a = false;
+                if (r.beats_out == r.expected_beats) {
+                    last_out_cycle = steps + 1;
+                    r.done = true;
                 }
+            }
 
-                // read b_matrix.bin to dut->col_data_in util end of file
-                if (not_starting_b || (dut->col_data_in_vld && dut->col_data_in_rdy)) {
-                    if (!b_matrix_bin.eof()){
-                        b_matrix_bin.read(reinterpret_cast<char*>(&dut->col_data_in), COLS);
-                    }
-                    not_starting_b = false;
-                }
+            // Stalls inside the compute window
+            if (first_in_seen && dut_stall(dut)) r.stall_cycles++;
 
-                
-                
-                /*** Deal with output signals ***/
-                // Randomly pull-up dut->row_data_out_rdy
-                if (rand() % 3 == 0) {
-                    dut->row_data_out_rdy = 1;
-                } else {
-                    dut->row_data_out_rdy = 0;
-                }
+            steps++;
+#if SAVABLE
+            save_due = args.checkpoint.due(steps);
+#endif
+        }
 
-                // Store dut->row_data_out to c_matrix_gen.bin
-                if (dut->row_data_out_vld && dut->row_data_out_rdy) { // transfer when vld && rdy
-                    results.write(reinterpret_cast<char*>(&dut->row_data_out), ROWS);
-                }
-                
-                
-                
-
-                // VL_OUT(golden_out,31,0);
-                // c_matrix_bin.read(reinterpret_cast<char*>(&golden_out), sizeof(golden_out));
-                // //compare dut->row_data_out with golden_out
-                // if (dut->row_data_out != golden_out){
-                //     std::cout << "ERROR: row_data_out != golden_out" << std::endl;
-                //     std::cout << "row_data_out = " << int(dut->row_data_out) << std::endl;
-                //     std::cout << "golden_out = " << int(golden_out) << std::endl;
-                //     std::cout << "systolic_steps = " << systolic_steps << std::endl;
-                //     // Final model cleanup
-                //     dut->final();
-                //     #ifdef VCD_OUTPUT
-                //         trace->close();
-                //         delete trace;
-                //     #endif
-                //     // Destroy DUT
-                //     delete dut;
-                //     // Fin
-                //     exit(0);
-                // }
-                systolic_steps++;
-                // std::cout << "systolic_steps = " << systolic_steps << std::endl;
-                timestamp_WB = timestamp - RESET_TIME;  
+        if (trace) trace->sample(time, steps, dut->row_data_out_vld, dut_stall(dut));
+        ++time;
+
+#if SAVABLE
+        // Between a rising edge and the next falling one
+        if (save_due && !r.done && !r.failed) {
+            if (!checkpoint_save(args.checkpoint.file, args.tag(seed), save_state)) {
+                exit(1);
             }
-            
-            
+            save_due = false;
         }
+#endif
+    }
+
+    r.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+#if PERF_COUNTERS
+    // Clock in the last accepted beat so the counters cover it too
+    if (r.done) {
+        dut->clk = 0;
+        dut->eval();
+        dut->clk = 1;
+        dut->eval();
+    }
+    r.perf = PerfCounters::read(dut) - perf_start;
+#endif
 
+    r.steps         = steps;
+    r.steps_run     = steps - first_step;
+    r.cycles        = r.done ? last_out_cycle - first_in_cycle : steps;
+    // Multiply-accumulates of the checked tests, PACK per PE per step
+    r.macs          = (uint64_t)ROWS * COLS * PACK * golden.steps_checked();
+    r.tests_checked = golden.tests_checked();
+    return r;
+}
 
-    #ifdef VCD_OUTPUT
-        trace->dump(timestamp);
-    #endif
-        ++timestamp;
+// +batch=N: seeds first_seed..first_seed+N-1, each on its own model with
+// its own stimulus and checker, +batch_threads= of them at a time. Prints
+// one line per seed, the messages of failing seeds and the totals.
+int run_batch_mode(int argc, char** argv, const BenchArgs& args, uint64_t first_seed, uint64_t batch) {
+    if (plusarg_str("trace=", "off") != "off") {
+        std::cerr << "ERROR: +trace= traces a single run, drop +batch= to use it" << std::endl;
+        exit(1);
+    }
+    if (args.checkpoint.enabled()) {
+        std::cerr << "ERROR: checkpoints hold a single run, drop +batch= to use them" << std::endl;
+        exit(1);
     }
+    const unsigned threads = (unsigned)plusarg_u64("batch_threads=", batch_threads_default());
 
-#ifdef DPRINTF
-    std::cout << "Cycles=" << (timestamp_WB / 2) << std::endl; 
+    std::vector<RunResult>   results(batch);
+    std::vector<std::string> logs(batch);
+
+    auto wall_start = std::chrono::steady_clock::now();
+    run_batch(batch, threads, [&](uint64_t i) {
+        // A context per model: no simulation state is shared between threads
+        std::unique_ptr<VerilatedContext> context(new VerilatedContext);
+        context->commandArgs(argc, argv);
+        std::unique_ptr<Vsystolic_array> dut(new Vsystolic_array(context.get()));
+        uint64_t time = 0;
+        LatencyTracker latency(args.latency_bins);
+        std::ostringstream log;
+        results[i] = run_seed(dut.get(), first_seed + i, args, time, nullptr, latency, log);
+        if (!results[i].done && !results[i].failed) {
+            log << "ERROR: timed out after " << results[i].steps << " cycles with "
+                << results[i].beats_out << "/" << results[i].expected_beats << " output beats" << std::endl;
+        }
+        dut->final();
+        logs[i] = log.str();
+    });
+    double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    RunResult total;
+    std::vector<uint64_t> failing;
+    for (uint64_t i = 0; i < batch; i++) {
+        const RunResult& r = results[i];
+        std::cout << "Seed=" << r.seed << " " << (r.passed() ? "PASSED" : r.failed ? "FAILED" : "TIMEOUT")
+                  << " Cycles=" << r.cycles << " Beats=" << r.beats_out << "/" << r.expected_beats
+                  << " StallCycles=" << r.stall_cycles << " WallTime=" << r.wall_time << "s" << std::endl;
+        total.cycles         += r.cycles;
+        total.steps          += r.steps;
+        total.beats_out      += r.beats_out;
+        total.expected_beats += r.expected_beats;
+        total.stall_cycles   += r.stall_cycles;
+        total.beats_a        += r.beats_a;
+        total.beats_b        += r.beats_b;
+        total.macs           += r.macs;
+        total.tests_checked  += r.tests_checked;
+        if (!r.passed()) failing.push_back(r.seed);
+    }
+    for (uint64_t i = 0; i < batch; i++) {
+        if (!results[i].passed()) {
+            std::cout << "-- Seed " << results[i].seed << " ---" << std::endl << logs[i];
+        }
+    }
+
+    std::cout << "Build=" << BUILD_FLAVOR << std::endl;
+    std::cout << "Dataflow=output_stationary" << std::endl;
+    std::cout << "Seeds=" << batch << std::endl;
+    std::cout << "Threads=" << std::min<uint64_t>(std::max(1u, threads), batch) << std::endl;
+    // Totals over the seeds
+    std::cout << "Cycles=" << total.cycles << std::endl;
+    std::cout << "Beats=" << total.beats_out << "/" << total.expected_beats << std::endl;
+    std::cout << "StallCycles=" << total.stall_cycles << std::endl;
+    std::cout << "InputBeatsA=" << total.beats_a << std::endl;
+    std::cout << "InputBeatsB=" << total.beats_b << std::endl;
+    std::cout << "MACs=" << total.macs << std::endl;
+    std::cout << "WallTime=" << wall_time << "s" << std::endl;
+    // Aggregate simulation throughput: every seed's cycles over the batch's wall time
+    std::cout << "CyclesPerSec=" << (wall_time > 0 ? total.steps / wall_time : 0) << std::endl;
+    std::cout << "SeedsPerSec=" << (wall_time > 0 ? batch / wall_time : 0) << std::endl;
+
+    if (failing.empty()) {
+        std::cout << "PASSED! " << batch << " seeds, " << total.tests_checked << " tests" << std::endl;
+        return 0;
+    }
+    std::cout << "FAILED! " << failing.size() << "/" << batch << " seeds:";
+    for (uint64_t s : failing) std::cout << " " << s;
+    std::cout << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv, char** env) {
+    // turn off unused variable warnings
+    if (0 && argc && argv && env) {}
+
+    Verilated::commandArgs(argc, argv);
+
+    // Stimulus is generated on the fly and checked against the reference
+    // beat by beat; nothing is read from or written to disk
+    const BenchArgs args = BenchArgs::parse();
+    const uint64_t  seed = plusarg_u64("seed=", SEED);
+
+    // Many seeds in one process (+batch=N), see run_batch_mode
+    const uint64_t batch = plusarg_u64("batch=", 0);
+    if (batch > 0) {
+        exit(run_batch_mode(argc, argv, args, seed, batch));
+    }
+
+    if (!SAVABLE && args.checkpoint.enabled()) {
+        std::cerr << "ERROR: +checkpoint_at=/+checkpoint_every=/+restore= need a model verilated with --savable, "
+                  << "rebuild with SAVABLE=1" << std::endl;
+        exit(1);
+    }
+
+    // Tracing is chosen at run time and must be enabled before the model is built
+    TraceWindow trace;
+    trace.parse_args();
+
+    // Construct the Verilated model
+    Vsystolic_array* dut = new Vsystolic_array();
+
+    // Per-test latency histogram (+latency_bins= / +latency_json=)
+    LatencyTracker latency(args.latency_bins);
+    const std::string latency_json = plusarg_str("latency_json=", "");
+
+    const RunResult r = run_seed(dut, seed, args, timestamp, &trace, latency, std::cout);
+
+    if (!r.done && !r.failed) {
+        std::cerr << "ERROR: timed out after " << r.steps << " cycles with "
+                  << r.beats_out << "/" << r.expected_beats << " output beats" << std::endl;
+    }
+
+    // Compute cycles span from the first accepted input beat to the last accepted output beat
+    std::cout << "Build=" << BUILD_FLAVOR << std::endl;
+    std::cout << "Dataflow=output_stationary" << std::endl;
+    std::cout << "Cycles=" << r.cycles << std::endl;
+    std::cout << "Beats=" << r.beats_out << "/" << r.expected_beats << std::endl;
+    std::cout << "StallCycles=" << r.stall_cycles << std::endl;
+    // Input traffic including any skew padding, data bits only (sideband bits excluded)
+    std::cout << "InputBeatsA=" << r.beats_a << std::endl;
+    std::cout << "InputBeatsB=" << r.beats_b << std::endl;
+    std::cout << "InputBits=" << r.beats_a * ROWS * IN_WIDTH + r.beats_b * COLS * IN_WIDTH << std::endl;
+    std::cout << "MACs=" << r.macs << std::endl;
+    std::cout << "WallTime=" << r.wall_time << "s" << std::endl;
+    // Simulation throughput over every clock cycle this run evaluated after reset
+    std::cout << "CyclesPerSec=" << (r.wall_time > 0 ? r.steps_run / r.wall_time : 0) << std::endl;
+#if PERF_COUNTERS
+    print_utilization(r.perf);
 #endif
+    latency.report(std::cout);
+    if (!latency_json.empty() && !latency.write_json(latency_json)) {
+        std::cerr << "ERROR: cannot write " << latency_json << std::endl;
+    }
 
     // Final model cleanup
     dut->final();
 
-#ifdef VCD_OUTPUT
-    trace->close();
-    delete trace;
-#endif
+    trace.close();
 
     // Destroy DUT
     delete dut;
-    // Close files
-    a_matrix_bin.close();
-    b_matrix_bin.close();
-    c_matrix_bin.close();
-    results.close();
-    
+
+    if (r.passed()) {
+        std::cout << "PASSED! " << r.tests_checked << " tests" << std::endl;
+    } else if (!r.failed) {
+        std::cout << "FAILED!" << std::endl;
+    }
+
     // Fin
-    exit(0);
-}
\ No newline at end of file
+    exit(r.passed() ? 0 : 1);
+}
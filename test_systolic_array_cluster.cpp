@@ -0,0 +1,319 @@
+// DESCRIPTION:  simulation of systolic_array_cluster, ARRAYS arrays fed by a tile scheduler
+//======================================================================
+// An (m_tiles*ROWS) x K by K x (n_tiles*COLS) GEMM is cut into ROWSxCOLS
+// tiles of C and spread over the arrays by TileScheduler (tb_scheduler.h).
+// Each array has its own stimulus and reference model, and every merged
+// output beat is checked against the model of the array it is tagged
+// with. The host link carries at most +link_beats= input beats (A and B
+// together) per cycle, 0 for no limit, to find where input bandwidth
+// starts to bound the speedup over one array.
+//======================================================================
+#include <iostream>
+#include <stdint.h>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Include common routines
+#include <verilated.h>
+// Include model header, generated from Verilating "systolic_array_cluster.v"
+#include "Vsystolic_array_cluster.h"
+
+// Perf flavor: no tracing in the hot loop
+#ifdef PERF_MODE
+#undef TRACE_FST
+#undef TRACE_VCD
+#define BUILD_FLAVOR "perf"
+#else
+#define BUILD_FLAVOR "debug"
+#endif
+
+#include "tb_args.h"
+#include "tb_bus.h"
+#include "tb_golden.h"
+#include "tb_scheduler.h"
+#include "tb_stimulus.h"
+#include "tb_trace.h"
+#include "tb_traffic.h"
+
+// Watchdog, in clock edges: give up if the expected results have not drained by then (+run_cycles=)
+#define RUN_CYCLES 10000000
+
+#define RESET_TIME  10
+
+// Default consumer on the merged output (+out_rdy=, see tb_traffic.h)
+#define OUT_RDY_TRAFFIC "always"
+
+// Defaults for +m_tiles= / +n_tiles= / +seed= / +data_bits= / +link_beats=
+#define M_TILES 4
+#define N_TILES 4
+#ifndef SEED
+#define SEED 1
+#endif
+#define DATA_BITS 3
+#define LINK_BEATS 0
+
+#ifndef IN_WIDTH
+#define IN_WIDTH 8
+#endif
+#ifndef OUT_WIDTH
+#define OUT_WIDTH 8
+#endif
+
+// Arrays in the cluster (-GARRAYS) and whether they share one B stream (-GSHARED_B)
+#ifndef ARRAYS
+#define ARRAYS 2
+#endif
+#ifndef SHARED_B
+#define SHARED_B 0
+#endif
+#define B_PORTS (SHARED_B ? 1 : ARRAYS)
+// Per-array vld/rdy/sideband ports are driven as bit masks
+static_assert(ARRAYS >= 1 && ARRAYS <= 32, "ARRAYS must be 1..32");
+
+// Output lanes per row of each array (-GDRAIN_LANES)
+#ifndef DRAIN_LANES
+#define DRAIN_LANES 1
+#endif
+static_assert(COLS % DRAIN_LANES == 0, "DRAIN_LANES must divide COLS");
+
+// Model built with -GINPUT_SKEW=1: the arrays skew their inputs, beats are sent dense
+#ifndef INPUT_SKEW
+#define INPUT_SKEW 0
+#endif
+
+// Current simulation time (64-bit unsigned)
+uint64_t timestamp = 0;
+uint64_t systolic_steps = 0;
+
+double sc_time_stamp() {
+  return timestamp;
+}
+
+int main(int argc, char** argv, char** env) {
+    // turn off unused variable warnings
+    if (0 && argc && argv && env) {}
+
+    Verilated::commandArgs(argc, argv);
+
+    // Tracing is chosen at run time and must be enabled before the model is built
+    TraceWindow trace;
+    trace.parse_args();
+
+    // Construct the Verilated model
+    Vsystolic_array_cluster* dut = new Vsystolic_array_cluster();
+
+    const int      m_tiles    = (int)plusarg_u64("m_tiles=", M_TILES);
+    const int      n_tiles    = (int)plusarg_u64("n_tiles=", N_TILES);
+    const uint64_t seed       = plusarg_u64("seed=", SEED);
+    const int      data_bits  = std::min((int)plusarg_u64("data_bits=", DATA_BITS), IN_WIDTH);
+    const uint64_t run_cycles = plusarg_u64("run_cycles=", RUN_CYCLES);
+    const int      link_beats = (int)plusarg_u64("link_beats=", LINK_BEATS);
+    const uint64_t beats_per_test = COLS / DRAIN_LANES;
+
+    Gemm          gemm(m_tiles * ROWS, n_tiles * COLS, K, seed, data_bits);
+    TileScheduler scheduler(m_tiles, n_tiles, ARRAYS, SHARED_B);
+    std::vector<std::unique_ptr<GoldenModel>>    golden;
+    std::vector<std::unique_ptr<TileSource>>     source;
+    std::vector<std::unique_ptr<SkewedStimulus>> stim;
+    for (int a = 0; a < ARRAYS; a++) {
+        golden.emplace_back(new GoldenModel(ROWS, COLS, K, IN_WIDTH, OUT_WIDTH, DRAIN_LANES));
+        source.emplace_back(new TileSource(gemm, scheduler, a, ROWS, COLS));
+        stim.emplace_back(new SkewedStimulus(ROWS, COLS, K, *source[a], golden[a].get(), !INPUT_SKEW));
+    }
+
+    // Consumer of the merged output, reproducible from +traffic_seed= (default +seed=)
+    const uint64_t traffic_seed = plusarg_u64("traffic_seed=", seed);
+    std::unique_ptr<Traffic> out_rdy = make_traffic(plusarg_str("out_rdy=", OUT_RDY_TRAFFIC), traffic_seed, "+out_rdy");
+
+    trace.open(dut);
+
+    dut->clk = 0;
+    dut->rst = 0;
+    dut->en  = 1;
+    dut->row_data_in_vld = 0;
+    dut->col_data_in_vld = 0;
+    dut->row_data_out_rdy = 0;
+
+    // Input ports in link arbitration order: the A ports, then the B ports
+    const int ports = ARRAYS + B_PORTS;
+    int       next_port = 0;
+    uint32_t  a_elems[ROWS * ARRAYS] = {};
+    uint32_t  b_elems[COLS * B_PORTS] = {};
+
+    // Handshakes decided after the previous rising edge, taken on this one
+    std::vector<bool> sent(ports, false);
+
+    // Run-to-completion bookkeeping, in clock cycles after reset
+    uint64_t beats_out       = 0;
+    uint64_t beats_a         = 0;
+    uint64_t beats_b         = 0;
+    uint64_t link_full       = 0;
+    uint64_t first_in_cycle  = 0;
+    uint64_t last_out_cycle  = 0;
+    bool     first_in_seen   = false;
+    bool     done            = false;
+    bool     failed          = false;
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    while (timestamp < run_cycles && !done && !failed) {
+        // One model evaluation per clock edge; timestamp counts edges
+        dut->clk = !dut->clk;
+
+        // Reset only changes on the falling edge, away from the sampling edge
+        if (!dut->clk) {
+            dut->rst = (timestamp > 1 && timestamp < RESET_TIME);
+        }
+
+        // Evaluate model
+        dut->eval();
+
+        // Drive the next beats right after the rising edge
+        if (dut->clk && timestamp > RESET_TIME) {
+            /*** Deal with input signals ***/
+            // Beats handed over on the edge just taken; a shared B beat went to every array
+            for (int a = 0; a < ARRAYS; a++) {
+                if (sent[a]) stim[a]->advance_a();
+            }
+            for (int p = 0; p < B_PORTS; p++) {
+                if (!sent[ARRAYS + p]) continue;
+                if (SHARED_B) {
+                    for (int a = 0; a < ARRAYS; a++) stim[a]->advance_b();
+                } else {
+                    stim[p]->advance_b();
+                }
+            }
+
+            uint32_t flush = 0;
+            for (int a = 0; a < ARRAYS; a++) {
+                if (stim[a]->done()) flush |= 1u << a;
+            }
+            dut->flush = flush;
+
+            // rdy is registered, so a beat offered to a ready port is taken on
+            // the next edge; the link grants up to link_beats of them round-robin
+            uint32_t a_vld = 0, b_vld = 0, rst_acc = 0, stream_out = 0;
+            int granted = 0;
+            for (int n = 0; n < ports; n++) {
+                int  p     = (next_port + n) % ports;
+                bool is_a  = p < ARRAYS;
+                int  q     = is_a ? p : p - ARRAYS;
+                bool want  = is_a ? !stim[q]->a_done() : !stim[q]->b_done();
+                bool ready = is_a ? (dut->row_data_in_rdy >> q) & 1 : (dut->col_data_in_rdy >> q) & 1;
+                sent[p] = want && ready && (link_beats == 0 || granted < link_beats);
+                if (!sent[p]) continue;
+                if (granted++ == 0) next_port = (p + 1) % ports;
+                if (is_a) {
+                    const uint32_t* beat = stim[q]->a_beat();
+                    std::copy(beat, beat + ROWS, a_elems + q * ROWS);
+                    a_vld      |= 1u << q;
+                    rst_acc    |= (uint32_t)stim[q]->rst_accumulator() << q;
+                    stream_out |= (uint32_t)stim[q]->stream_out() << q;
+                    beats_a++;
+                } else {
+                    const uint32_t* beat = stim[q]->b_beat();
+                    std::copy(beat, beat + COLS, b_elems + q * COLS);
+                    b_vld |= 1u << q;
+                    beats_b++;
+                }
+            }
+            if (link_beats && granted == link_beats) link_full++;
+            dut->row_data_in_vld     = a_vld;
+            dut->col_data_in_vld     = b_vld;
+            dut->rst_accumulator_rdy = rst_acc;
+            dut->stream_out_rdy      = stream_out;
+            Bus<ROWS * ARRAYS, IN_WIDTH>::pack(dut->row_data_in, a_elems);
+            Bus<COLS * B_PORTS, IN_WIDTH>::pack(dut->col_data_in, b_elems);
+            if (granted && !first_in_seen) {
+                first_in_cycle = systolic_steps + 1;
+                first_in_seen  = true;
+            }
+
+            /*** Deal with output signals ***/
+            // Consumer side of row_data_out
+            dut->row_data_out_rdy = out_rdy->next();
+
+            // Check the merged beat against the model of the array it came from
+            if (dut->row_data_out_vld && dut->row_data_out_rdy) { // transfer when vld && rdy
+                uint32_t out[ROWS * DRAIN_LANES];
+                Bus<ROWS * DRAIN_LANES, OUT_WIDTH>::unpack(dut->row_data_out, out);
+                int a = dut->row_data_out_array;
+                if (a >= ARRAYS || !golden[a]->check(out, systolic_steps)) {
+                    std::cout << "FAILED! on output beat of array " << a << std::endl;
+                    failed = true;
+                }
+                beats_out++;
+                last_out_cycle = systolic_steps + 1;
+            }
+
+            // Every array has been fed everything and has drained all its tiles
+            done = true;
+            for (int a = 0; a < ARRAYS; a++) {
+                done = done && stim[a]->done() && golden[a]->tests_checked() == golden[a]->tests_pushed();
+            }
+
+            systolic_steps++;
+        }
+
+        trace.sample(timestamp, systolic_steps, dut->row_data_out_vld, false);
+        ++timestamp;
+    }
+
+    double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    uint64_t tiles_taken = 0;
+    uint64_t tiles_real  = 0;
+    for (int a = 0; a < ARRAYS; a++) {
+        tiles_taken += scheduler.taken(a);
+        tiles_real  += scheduler.real(a);
+    }
+    const uint64_t cycles = done ? last_out_cycle - first_in_cycle : systolic_steps;
+
+    if (!done && !failed) {
+        std::cerr << "ERROR: timed out after " << systolic_steps << " cycles with "
+                  << beats_out << "/" << tiles_taken * beats_per_test << " output beats" << std::endl;
+    }
+
+    // Compute cycles span from the first accepted input beat to the last accepted output beat
+    std::cout << "Build=" << BUILD_FLAVOR << std::endl;
+    std::cout << "Arrays=" << ARRAYS << std::endl;
+    std::cout << "SharedB=" << SHARED_B << std::endl;
+    std::cout << "LinkBeats=" << link_beats << std::endl;
+    std::cout << "Cycles=" << cycles << std::endl;
+    std::cout << "Beats=" << beats_out << "/" << tiles_taken * beats_per_test << std::endl;
+    std::cout << "Tiles=" << tiles_real << "/" << scheduler.tiles() << std::endl;
+    std::cout << "IdleTiles=" << tiles_taken - tiles_real << std::endl;
+    // Input traffic including any skew padding, data bits only; a shared B beat counts once
+    std::cout << "InputBeatsA=" << beats_a << std::endl;
+    std::cout << "InputBeatsB=" << beats_b << std::endl;
+    std::cout << "InputBits=" << beats_a * ROWS * IN_WIDTH + beats_b * COLS * IN_WIDTH << std::endl;
+    // Cycles in which the host link could not have taken another beat
+    std::cout << "LinkFullCycles=" << link_full << std::endl;
+    std::cout << "MACs=" << (uint64_t)ROWS * COLS * K * tiles_real << std::endl;
+    for (int a = 0; a < ARRAYS; a++) {
+        std::cout << "Array" << a << "Tiles=" << scheduler.real(a) << std::endl;
+    }
+    std::cout << "WallTime=" << wall_time << "s" << std::endl;
+    // Simulation throughput over every clock cycle evaluated after reset
+    std::cout << "CyclesPerSec=" << (wall_time > 0 ? systolic_steps / wall_time : 0) << std::endl;
+
+    // Final model cleanup
+    dut->final();
+
+    trace.close();
+
+    // Destroy DUT
+    delete dut;
+
+    if (done && !failed) {
+        std::cout << "PASSED! " << tiles_real << " tiles" << std::endl;
+    } else if (!failed) {
+        std::cout << "FAILED!" << std::endl;
+    }
+
+    // Fin
+    exit(done && !failed ? 0 : 1);
+}
@@ -0,0 +1,251 @@
+// DESCRIPTION:  simulation of systolic_array_ws, the weight-stationary array
+//======================================================================
+// Each test multiplies a ROWS x K A by a K x COLS B on a K x COLS array.
+// B is loaded into the PEs once per +b_reuse= tests (default: once for
+// the whole run) and A streams through one dense row per beat. Reports
+// the same Cycles=/MACs= as test_systolic_array plus the input beats and
+// bits handed over, for make ws_compare.
+//======================================================================
+#include <iostream>
+#include <stdint.h>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+
+// Include common routines
+#include <verilated.h>
+// Include model header, generated from Verilating "systolic_array_ws.v"
+#include "Vsystolic_array_ws.h"
+
+// Perf flavor: no tracing in the hot loop
+#ifdef PERF_MODE
+#undef TRACE_FST
+#undef TRACE_VCD
+#define BUILD_FLAVOR "perf"
+#else
+#define BUILD_FLAVOR "debug"
+#endif
+
+#include "tb_args.h"
+#include "tb_bus.h"
+#include "tb_golden.h"
+#include "tb_latency.h"
+#include "tb_stimulus.h"
+#include "tb_trace.h"
+#include "tb_traffic.h"
+
+// Watchdog, in clock edges: give up if the expected results have not drained by then (+run_cycles=)
+#define RUN_CYCLES 10000000
+
+#define RESET_TIME  10
+
+// Default traffic on the AXI stream ports (+out_rdy= / +a_vld= / +b_vld=, see tb_traffic.h)
+#define OUT_RDY_TRAFFIC "duty:0.333"
+#define IN_VLD_TRAFFIC  "always"
+
+// Defaults for +num_tests= / +seed= / +data_bits=
+#ifndef NUM_TESTS
+#define NUM_TESTS 1
+#endif
+#ifndef SEED
+#define SEED 1
+#endif
+#define DATA_BITS 3
+
+#ifndef IN_WIDTH
+#define IN_WIDTH 8
+#endif
+#ifndef OUT_WIDTH
+#define OUT_WIDTH 8
+#endif
+
+// Current simulation time (64-bit unsigned)
+uint64_t timestamp = 0;
+uint64_t systolic_steps = 0;
+
+double sc_time_stamp() {
+  return timestamp;
+}
+
+int main(int argc, char** argv, char** env) {
+    // turn off unused variable warnings
+    if (0 && argc && argv && env) {}
+
+    Verilated::commandArgs(argc, argv);
+
+    // Tracing is chosen at run time and must be enabled before the model is built
+    TraceWindow trace;
+    trace.parse_args();
+
+    // Construct the Verilated model
+    Vsystolic_array_ws* dut = new Vsystolic_array_ws();
+
+    const uint64_t num_tests = plusarg_u64("num_tests=", NUM_TESTS);
+    const uint64_t seed      = plusarg_u64("seed=", SEED);
+    const int      data_bits = std::min((int)plusarg_u64("data_bits=", DATA_BITS), IN_WIDTH);
+    const uint64_t run_cycles = plusarg_u64("run_cycles=", RUN_CYCLES);
+    // Tests sharing one B, i.e. one weight load
+    const uint64_t b_reuse   = std::max(plusarg_u64("b_reuse=", num_tests), (uint64_t)1);
+    // Each test drains one beat of COLS values per row of A
+    const uint64_t beats_per_test = ROWS;
+    const uint64_t expected_beats = beats_per_test * num_tests;
+
+    GoldenModel    golden(ROWS, COLS, K, IN_WIDTH, OUT_WIDTH);
+    RandomSource   source(ROWS, COLS, K, num_tests, seed, data_bits, 1, IN_WIDTH, b_reuse);
+    DenseStimulus  stim(ROWS, COLS, K, num_tests, b_reuse, source, &golden);
+    // Per-test latency, first A beat accepted to last output beat accepted (+latency_bins= / +latency_json=)
+    LatencyTracker latency((int)plusarg_u64("latency_bins=", 20));
+    const std::string latency_json = plusarg_str("latency_json=", "");
+
+    // Ready/valid traffic, reproducible from +traffic_seed= (default +seed=)
+    const uint64_t traffic_seed = plusarg_u64("traffic_seed=", seed);
+    std::unique_ptr<Traffic> out_rdy = make_traffic(plusarg_str("out_rdy=", OUT_RDY_TRAFFIC), traffic_seed, "+out_rdy");
+    std::unique_ptr<Traffic> a_vld   = make_traffic(plusarg_str("a_vld=", IN_VLD_TRAFFIC), traffic_seed + 1, "+a_vld");
+    std::unique_ptr<Traffic> b_vld   = make_traffic(plusarg_str("b_vld=", IN_VLD_TRAFFIC), traffic_seed + 2, "+b_vld");
+
+    trace.open(dut);
+
+    dut->clk = 0;
+    dut->rst = 0;
+    dut->row_data_in_vld = 0;
+    dut->col_data_in_vld = 0;
+    dut->row_data_out_rdy = 0;
+
+    // Handshakes decided after the previous rising edge, taken on this one
+    bool a_sent = false;
+    bool b_sent = false;
+
+    // Run-to-completion bookkeeping, in clock cycles after reset
+    uint64_t beats_out       = 0;
+    uint64_t beats_a         = 0;
+    uint64_t beats_b         = 0;
+    uint64_t first_in_cycle  = 0;
+    uint64_t last_out_cycle  = 0;
+    bool     first_in_seen   = false;
+    bool     done            = false;
+    bool     failed          = false;
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    while (timestamp < run_cycles && !done && !failed) {
+        // One model evaluation per clock edge; timestamp counts edges
+        dut->clk = !dut->clk;
+
+        // Reset only changes on the falling edge, away from the sampling edge
+        if (!dut->clk) {
+            dut->rst = (timestamp > 1 && timestamp < RESET_TIME);
+        }
+
+        // Evaluate model
+        dut->eval();
+
+        // Drive the next beat right after the rising edge
+        if (dut->clk && timestamp > RESET_TIME) {
+            /*** Deal with input signals ***/
+            // A beat offered but not taken stays valid, as AXI stream requires
+            const bool a_hold = dut->row_data_in_vld && !a_sent;
+            const bool b_hold = dut->col_data_in_vld && !b_sent;
+            const bool a_want = a_vld->next();
+            const bool b_want = b_vld->next();
+
+            // Beats handed over on the edge just taken
+            if (a_sent) stim.advance_a();
+            if (b_sent) stim.advance_b();
+
+            // Present the next dense row of A with its weight swap marker
+            dut->row_data_in_vld = !stim.a_done() && (a_hold || a_want);
+            if (dut->row_data_in_vld) {
+                Bus<K, IN_WIDTH>::pack(dut->row_data_in, stim.a_beat());
+                dut->swap_weights_rdy = stim.swap_weights();
+            }
+
+            // Present the next row of B
+            dut->col_data_in_vld = !stim.b_done() && (b_hold || b_want);
+            if (dut->col_data_in_vld) {
+                Bus<COLS, IN_WIDTH>::pack(dut->col_data_in, stim.b_beat());
+            }
+
+            // rdy is registered, so it already tells whether the next edge takes the beat
+            a_sent = dut->row_data_in_vld && dut->row_data_in_rdy;
+            b_sent = dut->col_data_in_vld && dut->col_data_in_rdy;
+            if (a_sent) beats_a++;
+            if (b_sent) beats_b++;
+            if (a_sent && stim.beat_a() % ROWS == 0) {
+                latency.admit(stim.beat_a() / ROWS, systolic_steps + 1);
+            }
+            // The first weight load counts: it is input traffic the other dataflow does not have up front
+            if ((a_sent || b_sent) && !first_in_seen) {
+                first_in_cycle = systolic_steps + 1;
+                first_in_seen  = true;
+            }
+
+            /*** Deal with output signals ***/
+            // Consumer side of row_data_out
+            dut->row_data_out_rdy = out_rdy->next();
+
+            // Check dut->row_data_out against the reference
+            if (dut->row_data_out_vld && dut->row_data_out_rdy) { // transfer when vld && rdy
+                uint32_t out[COLS];
+                Bus<COLS, OUT_WIDTH>::unpack(dut->row_data_out, out);
+                if (!golden.check_row(out, systolic_steps)) {
+                    failed = true;
+                }
+                // The beat is taken on the next rising edge
+                if (++beats_out % beats_per_test == 0) {
+                    latency.complete(beats_out / beats_per_test - 1, systolic_steps + 1);
+                }
+                if (beats_out == expected_beats) {
+                    last_out_cycle = systolic_steps + 1;
+                    done = true;
+                }
+            }
+
+            systolic_steps++;
+        }
+
+        trace.sample(timestamp, systolic_steps, dut->row_data_out_vld, false);
+        ++timestamp;
+    }
+
+    double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    if (!done && !failed) {
+        std::cerr << "ERROR: timed out after " << systolic_steps << " cycles with "
+                  << beats_out << "/" << expected_beats << " output beats" << std::endl;
+    }
+
+    // Compute cycles span from the first accepted input beat to the last accepted output beat
+    std::cout << "Build=" << BUILD_FLAVOR << std::endl;
+    std::cout << "Dataflow=weight_stationary" << std::endl;
+    std::cout << "Cycles=" << (done ? last_out_cycle - first_in_cycle : systolic_steps) << std::endl;
+    std::cout << "Beats=" << beats_out << "/" << expected_beats << std::endl;
+    // Input traffic, data bits only (the swap marker is sideband)
+    std::cout << "InputBeatsA=" << beats_a << std::endl;
+    std::cout << "InputBeatsB=" << beats_b << std::endl;
+    std::cout << "InputBits=" << beats_a * K * IN_WIDTH + beats_b * COLS * IN_WIDTH << std::endl;
+    std::cout << "MACs=" << (uint64_t)ROWS * COLS * K * golden.tests_checked() << std::endl;
+    std::cout << "WallTime=" << wall_time << "s" << std::endl;
+    // Simulation throughput over every clock cycle evaluated after reset
+    std::cout << "CyclesPerSec=" << (wall_time > 0 ? systolic_steps / wall_time : 0) << std::endl;
+    latency.report(std::cout);
+    if (!latency_json.empty() && !latency.write_json(latency_json)) {
+        std::cerr << "ERROR: cannot write " << latency_json << std::endl;
+    }
+
+    // Final model cleanup
+    dut->final();
+
+    trace.close();
+
+    // Destroy DUT
+    delete dut;
+
+    if (done && !failed) {
+        std::cout << "PASSED! " << golden.tests_checked() << " tests" << std::endl;
+    } else if (!failed) {
+        std::cout << "FAILED!" << std::endl;
+    }
+
+    // Fin
+    exit(done && !failed ? 0 : 1);
+}